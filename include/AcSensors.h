@@ -10,64 +10,128 @@
 #include <Servo.h>
 #include "Debug.h"
 #include "Configuration.h"
+#include "GateConfig.h"
+#include "PackedSamples.h"
 
   class AcSensors {
      
-    static const int ac_sensor_1 = AC_SENSOR_PIN_1;
-    static const int ac_sensor_2 = AC_SENSOR_PIN_2;
-    static const int ac_sensor_3 = AC_SENSOR_PIN_3; 
-    static const int ac_sensor_4 = AC_SENSOR_PIN_4;
-    static const int ac_sensor_5 = AC_SENSOR_PIN_5;
-    static const int ac_sensor_6 = AC_SENSOR_PIN_6;
-    static const int ac_sensor_7 = AC_SENSOR_PIN_7;
-    static const int ac_sensor_8 = AC_SENSOR_PIN_8;
-
-    static const int led_pin_1 = LED_PIN_1;
-    static const int led_pin_2 = LED_PIN_2;
-    static const int led_pin_3 = LED_PIN_3;
-    static const int led_pin_4 = LED_PIN_4;
-    static const int led_pin_5 = LED_PIN_5;
-    static const int led_pin_6 = LED_PIN_6;
-    static const int led_pin_7 = LED_PIN_7;
-    static const int led_pin_8 = LED_PIN_8;
-    
     static const float acsensorsentitivity;
     static const int numoffmaxsamples = NUM_OFF_MAX_SAMPLES;
     static const int maxblinklen = MAX_BLINK_LEN;
     static const int numoffsamples = NUM_OFF_SAMPLES;
     static const int avg_readings = AVG_READINGS;
     static const int ac_sensors = NUM_AC_SENSORS;
-    static const int max_sensors = 8;
+    static const unsigned long recalibrateQuietMs = RECALIBRATE_QUIET_MS;
 
-    // Flutter protection constants
-    static const float sensitivityOn = AC_SENSOR_SENSITIVITY_ON;
-    static const float sensitivityOff = AC_SENSOR_SENSITIVITY_OFF;
-    static const int debounceStableReadings = DEBOUNCE_STABLE_READINGS;
+    // Detection uses no floating point. The sensitivities are Q8 fixed point
+    // (256 = 1.0) and cycle mode amplitudes Q4 (16 = 1 ADC step).
+    static const int sensitivity_shift = 8;
+    static const int amplitude_shift = 4;
+
+    // Flutter protection settings, SetTuning() can change them for replays
+    int sensitivityOnQ8 = (int)(AC_SENSOR_SENSITIVITY_ON * (1 << sensitivity_shift) + 0.5);
+    int sensitivityOffQ8 = (int)(AC_SENSOR_SENSITIVITY_OFF * (1 << sensitivity_shift) + 0.5);
+    int debounceStableReadings = DEBOUNCE_STABLE_READINGS;
+    int avgWindow = avg_readings;               // readings averaged, no more than AVG_READINGS
 
     int curreadingindex = 0;
-    int blinktimers[max_sensors] = {0,0,0,0,0,0,0,0};
-    bool blinkon[max_sensors]= {false, false, false, false, false, false, false, false};
-    const int sensorPins[max_sensors] = { ac_sensor_1, ac_sensor_2, ac_sensor_3, ac_sensor_4, ac_sensor_5, ac_sensor_6, ac_sensor_7, ac_sensor_8 };
-    const int ledpin[max_sensors] = {led_pin_1,led_pin_2,led_pin_3,led_pin_4,led_pin_5,led_pin_6,led_pin_7,led_pin_8}; // LED pins
+    int blinktimers[ac_sensors] = {};
+    bool blinkon[ac_sensors] = {};
     float offReadings[ac_sensors];
-    int recentReadings[ac_sensors][avg_readings];
+    float offMean[ac_sensors];                  // mean raw reading while calibrating
+    float offVariance[ac_sensors];              // variance of the raw readings while calibrating
+    PackedSamples<avg_readings> recentReadings[ac_sensors]; // last avgWindow pass averages, 10 bits each
+    long readingTotals[ac_sensors];             // running sum of recentReadings for each sensor
+    long passTotal[ac_sensors];                 // samples collected since the last ReadSensors() pass
+    int passCount[ac_sensors];
+    bool passAbove[ac_sensors];                 // one of them was above the on threshold
     
+    // Whole mains cycle amplitude tracking, one window per sensor
+    struct CycleWindow {
+      long sum;              // sum of samples in the window
+      long sumSquares;       // sum of squared samples in the window
+      int minValue;
+      int maxValue;
+      int count;             // samples collected so far
+      long goertzel1;        // Goertzel filter state s[n-1]
+      long goertzel2;        // Goertzel filter state s[n-2]
+      int bias;              // mean of the previous window, removed before the Goertzel filter (-1 = unknown)
+    };
+    CycleWindow cycleWindow[ac_sensors];
+    int windowSamples = 1;                      // samples per window, set when sampling starts
+    int goertzelCoeff = 0;                      // 2*cos(2*pi*MAINS_HZ/sample rate) in Q14 fixed point
+    int amplitudeQ4[ac_sensors];                // RMS, peak to peak or mains amplitude of the last complete window
+
+    // Thresholds in the units of detectorValue(), worked out from the baselines
+    // and sensitivities by updateThresholds() whenever either changes
+    long onLimit[ac_sensors];                   // an off sensor turns on above this
+    long offLimit[ac_sensors];                  // an on sensor turns off at or below this
+    int sampleOnLimit[ac_sensors];              // a raw sample above this is an onset (DETECT_MEAN)
+    int offLevel[ac_sensors];                   // whole ADC steps of the baseline, for the meter
+
+    #if ENABLE_FAST_TRIGGER
+    // Inrush detection, one value per window: the sample sum in DETECT_MEAN mode, the Q4 amplitude otherwise
+    static const int fast_sensitivity_q8 = (int)(FAST_TRIGGER_SENSITIVITY * (1 << sensitivity_shift) + 0.5);
+    long fastLimit[ac_sensors];                 // a window above this is far above the baseline
+    long fastLow[ac_sensors];                   // a window at or below this is off
+    long fastSum[ac_sensors] = {};              // samples in the current window (DETECT_MEAN)
+    int fastCount[ac_sensors] = {};
+    uint8_t fastSinceLow[ac_sensors] = {};      // windows since the last one at or below fastLow
+    bool fastPending[ac_sensors] = {};          // inrush seen, not yet collected by FastTriggered()
+    void checkFastTrigger(int sensor, long value, bool watching); // Look for an inrush in a completed window
+    #endif
+
+    // Baseline calibration, blocking at a cold boot or in the background after a warm boot
+    struct OffStats {
+      int maxValue;                // highest raw sample
+      long total;                  // sum of raw samples
+      unsigned long long squares;  // sum of squared raw samples
+      long count;
+      int maxAmplitudeQ4;          // highest window amplitude (cycle based modes)
+    };
+    OffStats offStats[ac_sensors];
+    bool calibrating = false;                   // offStats is collecting samples
+    unsigned long calibrationStart = 0;
+    bool baselinesValid = false;                // offReadings can be used for detection
+    bool baselinesChanged = false;              // new baselines not yet collected by BaselinesChanged()
+    bool recalibrationPending = false;          // warm boot, take fresh baselines when all tools are off
+    unsigned long quietSince = 0;               // when the last tool turned off
+
+    void startSampling();                       // Set up LED pins and start the background sampler
+    void beginCalibration();                    // Reset baseline statistics and start collecting
+    void finishCalibration();                   // Turn baseline statistics into offReadings
+    void updateThresholds();                    // Recompute the integer thresholds from offReadings and the sensitivities
+    long detectorValue(int sensor);             // Reading compared against the thresholds: window sum (DETECT_MEAN) or Q4 amplitude
+    long detectorScale();                       // detectorValue() of a reading of 1.0
+    void updateBackgroundCalibration();         // Start, abandon or finish a background calibration
+    bool processSample(int sensor, int value);  // Feed one raw sample to calibration and the cycle detectors, true if it's above the on threshold
+    bool addCycleSample(int sensor, int value); // Add a sample to the cycle window, returns true when a window completes
+    bool updateSensorState(int forsensor, long reading); // Hysteresis and debounce for a new detectorValue()
+
     // Flutter protection state tracking
-    bool sensorState[max_sensors] = {false, false, false, false, false, false, false, false}; // Current state (true = tool on)
-    int debounceCounter[max_sensors] = {0, 0, 0, 0, 0, 0, 0, 0}; // Consecutive readings in desired state
+    bool sensorState[ac_sensors] = {};          // Current state (true = tool on)
+    int debounceCounter[ac_sensors] = {};       // Consecutive readings in desired state
     
     public:    
       AcSensors();
       void InitializeSensors();               // Initialize sensors and read a baseline sensor reading with tools off
+      void InitializeSensors(const float *savedOffReadings); // Initialize sensors using saved baselines, recalibrate in the background
+      bool BaselinesChanged();                // True once after new baselines are calibrated
+      void SetTuning(float on, float off, int debounce, int window); // Replace the Configuration.h thresholds, debounce count and averaging window
       float AvgSensorReading(int forsensor);  // returns an average of the last X sensors readings for given sensor
       bool Triggered(int sensor);             // Returns true if the given AC current sensor number is triggered     
-      void getMaxOffSensorReadings();         // Poll for NUM_OFF_MAX_SAMPLES ms to determine maximum 'off' sensor reading for this sensor
+      bool FastTriggered(int sensor);         // True once when an off sensor sees a motor inrush (ENABLE_FAST_TRIGGER)
+      void getMaxOffSensorReadings();         // Poll all sensors together for NUM_OFF_MAX_SAMPLES ms to determine their 'off' baselines
       void getAvgOffSensorReadings();         // Determine average 'off' reading for each sensor. 
-      void ReadSensors();                     // Read values for AC current sensors and add to list of values we will average
+      void CollectSamples();                  // Feed sampled values to the detectors, ReadSensors() averages them
+      void ReadSensors();                     // Collect sampled values for AC current sensors and add to list of values we will average
       void DisplayMeter();                    // Use LEDs to display a meter for positioning AC sensor clamps. 
       void displayaverages(int cursensor);    // Debugging function to display values polled for given sensor
       float GetOffReading(int sensor);        // Get the off reading for a specific sensor
       float GetAvgReading(int sensor);        // Get the average reading for a specific sensor
+      float GetOffMean(int sensor);           // Mean raw reading seen while calibrating
+      float GetOffVariance(int sensor);       // Variance of the raw readings seen while calibrating
+      float DetectorReading(int sensor);      // Value compared against the off reading for the configured DETECTION_MODE
       static const int num_ac_sensors = NUM_AC_SENSORS;
   };
   
@@ -0,0 +1,32 @@
+/*
+  AdcSampler.h - Timer driven background sampling of the AC current sensor inputs
+  Released into the public domain.
+*/
+#ifndef AdcSampler_h
+#define AdcSampler_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+
+  // Timer2 starts an ADC conversion at a fixed rate and the ADC complete
+  // interrupt stores the result in a per-sensor ring buffer, stepping round-robin
+  // through the sensor pins in GateConfig. The sample rate does not depend on how
+  // long loop() takes. analogRead() must not be used while the sampler is running.
+  class AdcSampler {
+    public:
+      static const int max_channels = NUM_AC_SENSORS;         // one ring per configured sensor
+      static const int ring_size = ADC_RING_SIZE;              // samples buffered per sensor
+      static const long sample_rate = ADC_SAMPLE_RATE_HZ;      // aggregate samples per second
+
+      static void begin(int count);                   // start sampling the first count sensors in GateConfig
+      static void end();                              // stop sampling, analogRead() may be used again
+      static int available(int channel);              // number of unread samples for a channel
+      static int read(int channel);                   // oldest unread sample for a channel
+      static unsigned int overruns();                 // samples dropped because a ring was full
+      static long channelRate();                      // samples per second for each active channel
+      #ifndef __AVR__
+      static void sampleTick();                       // one sample period elapsed (host build timer)
+      #endif
+  };
+
+#endif
@@ -0,0 +1,36 @@
+/*
+  ButtonEdges.h - Pin change interrupt capture of the button's edges
+  Released into the public domain.
+*/
+#ifndef ButtonEdges_h
+#define ButtonEdges_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+
+  // The pin change interrupt records every level change of BUTTON_PIN with
+  // the millis() it happened at, so a press is seen even if the button task
+  // runs late, and debouncing can use the time of the edge rather than the
+  // time it was noticed. Times are kept as the low 16 bits of millis(), the
+  // queue has to be read at least once a minute for them to stay right.
+  //
+  // If contact bounce fills the queue, later edges are dropped and counted
+  // until it is read. overflowed() tells the reader to go by the pin's
+  // current level instead.
+  class ButtonEdges {
+    public:
+      static const int queue_size = BUTTON_EDGE_QUEUE;
+
+      struct Edge {
+        unsigned long time;       // millis() of the change
+        uint8_t level;            // HIGH or LOW after the change
+      };
+
+      static void begin();                            // start capturing edges, the pin must already be an input
+      static bool read(Edge &edge);                   // oldest unread edge, false if there are none
+      static bool overflowed();                       // edges were dropped since the last call
+      static unsigned int overruns();                 // edges dropped since begin()
+      static void pinChanged();                       // interrupt handler body, also called by the host build
+  };
+
+#endif
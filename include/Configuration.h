@@ -21,18 +21,107 @@
 // servo stuff 
 #define CLOSE_DELAY 1000 // how long it takes a gate to close
 #define OPEN_DELAY 800 // how long after last button push to open gate
+#define SERVO_SETTLE_MS 50 // how long to hold a servo after its move before detaching it
+
+// Servo travel times - with the servo supply current on a spare analog pin (e.g. a shunt resistor and amplifier),
+// the m serial command times each gate's open and close moves and saves them in EEPROM. Moves then last that long
+// instead of OPEN_DELAY / CLOSE_DELAY. Gates that haven't been timed keep the fixed delays.
+#ifndef SERVO_CURRENT_PIN
+#define SERVO_CURRENT_PIN -1          // analog pin reading the servo supply current, -1 = none
+#endif
+#define SERVO_CURRENT_MARGIN 20       // ADC counts above the holding current that mean the servo is still moving
+#define SERVO_SETTLE_DETECT_MS 30     // the current must stay down this long for a move to count as finished
+#define SERVO_TRAVEL_TIMEOUT_MS 3000  // a move that hasn't settled by then is reported and keeps the fixed delay
+#define MAX_CONCURRENT_SERVOS 2 // servos allowed to move (be attached) at once, each can draw an amp or more stalled,
+                                // so keep this within what the 5V supply can deliver (1 = one at a time)
+
+// Servo outputs - SERVO_BACKEND_PINS drives each gate's servo from its own Uno pin with the Servo library.
+// SERVO_BACKEND_PCA9685 drives them from PCA9685 16 channel PWM boards on the I2C bus (A4 = SDA, A5 = SCL,
+// so those two can't be sensor or LED pins), which is the way to run more gates than the Uno has free pins.
+// Then each SERVO_PIN_ setting is a channel number instead of a pin: 0-15 on the first board, 16-31 on the
+// second and so on. Each motion task tick sends all of a board's changed channels in one bus transaction.
+#define SERVO_BACKEND_PINS     0
+#define SERVO_BACKEND_PCA9685  1
+#ifndef SERVO_BACKEND
+#define SERVO_BACKEND SERVO_BACKEND_PINS
+#endif
+#define PCA9685_BOARDS 1              // boards chained on the bus, at PCA9685_ADDRESS, PCA9685_ADDRESS + 1, ...
+#define PCA9685_ADDRESS 0x40          // I2C address of the first board (all address jumpers open)
+#define PCA9685_OSC_HZ 25000000       // the boards' internal oscillator, trim it if gates stop short of their positions
+#define PCA9685_I2C_HZ 400000         // I2C bus clock
+
+// Button gate swaps open the new gate before closing the old one, so the dust collector always has an open duct.
+// The old gate starts closing once the new gate's opening move is this far along (0 = both move together,
+// 100 = the new gate is fully open first). Both gates move at once only if MAX_CONCURRENT_SERVOS is 2 or more.
+#define SWAP_OVERLAP_PERCENT 50
+// Overlap for particular swaps, { from gate, to gate, percent } numbered from 1, e.g. { { 1, 3, 80 }, { 3, 1, 80 } }
+#define SWAP_OVERLAP_PAIRS { { 0, 0, 0 } }   // none
 
 #define HAS_BUTTON true  // true if button is attached
 #define BUTTON_PIN 13    // the number of the pushbutton pin
+#define BUTTON_EDGE_QUEUE 8 // button edges buffered by the pin change interrupt (power of two, no more than 128)
+                            // The interrupt uses all three pin change vectors, so SoftwareSerial can't be used
 
 /// current Sensor stuff
 #define NUM_AC_SENSORS 5        // Number of AC sensors connected.. currently only handles 1 per gate
 #define NUM_LEDS 5              // Number of LEDs connected.. optional but should be 1 per gate
-#define NUM_GATES 5             // Number of blast gates with servos connected
+#define NUM_GATES 5             // Number of blast gates with servos connected (up to 16)
 #define NUM_OFF_SAMPLES 50      // number of samples when checking avg sensor off values (unused)
-#define NUM_OFF_MAX_SAMPLES 500 // Milliseconds to sample for max off value for each gate when starting up
-#define AVG_READINGS 25         // number of readings to average when triggering gates.. higher number is more accurate but more delay ( no more than 50)
+#define NUM_OFF_MAX_SAMPLES 500 // Milliseconds to sample all sensors together for their off baselines when starting up
+#define AVG_READINGS 25         // number of readings to average when triggering gates.. higher number is more accurate but more delay (limited by SRAM, 10 bits per reading per sensor)
 #define AC_SENSOR_SENSITIVITY 2.0 // Triggers on twice the max readings of the off setting. The closer to one, the more sensitive
+#define ADC_SAMPLE_RATE_HZ 2000  // Background sensor samples per second, shared round-robin by all sensor pins (1953 - 9000)
+                                 // Sampling uses Timer2, so tone() and analogWrite() on pins 3 and 11 are unavailable
+#define ADC_RING_SIZE 32         // Samples buffered per sensor between loop passes (power of two, no more than 128)
+                                 // 2 bytes of SRAM each, 32 cover 80 ms at the default rates
+
+// Detection mode - what Triggered() compares against the off baseline
+#define DETECT_MEAN          0  // average of the sensor readings vs the max off reading (original behaviour)
+#define DETECT_RMS           1  // RMS of the AC swing over whole mains cycles vs the off RMS
+#define DETECT_PEAK_TO_PEAK  2  // peak to peak swing over whole mains cycles vs the off swing
+#define DETECT_GOERTZEL      3  // mains frequency component only (Goertzel filter) vs the off level, rejects VFD/LED driver noise
+#define DETECTION_MODE DETECT_MEAN
+#define MAINS_HZ 60               // Mains frequency, 50 or 60
+#define DETECT_WINDOW_CYCLES 2    // Mains cycles in each RMS / peak to peak / Goertzel window, each window is one debounce reading
+                                  // In Goertzel mode more cycles give a narrower filter but a slower response
+#define MIN_OFF_AMPLITUDE 4.0     // Lowest baseline for the cycle based modes so ADC noise on a quiet sensor can't trigger it
+
+// Warm boot - sensor baselines and gate positions are saved in EEPROM so a power cycle
+// can skip the startup calibration and re-homing of gates known to be closed
+#define ENABLE_WARM_BOOT true
+#define SETTINGS_EEPROM_ADDRESS 0    // EEPROM address of the saved settings record
+#define RECALIBRATE_QUIET_MS 10000   // After a warm boot, recalibrate once all tools have been off this long
+
+// Latency statistics - time from a tool's first current to its gate being open, kept per gate in RAM
+// (about 170 bytes for 5 gates, which neither the release nor the debug build can spare, so only the
+// uno-latency and native builds turn them on). Send l on the serial port (9600 baud) to print them,
+// t to print the task timing below, c to clear both
+#ifndef ENABLE_LATENCY_STATS
+#define ENABLE_LATENCY_STATS false
+#endif
+
+// Task rates - loop() runs each job when it is due and sleeps when nothing is, see Scheduler.h
+#define TASK_SAMPLE_HZ 1000   // move sensor samples from the sampler into the detectors
+#define TASK_DETECT_HZ 20     // average, debounce and open/close gates. AVG_READINGS and DEBOUNCE_STABLE_READINGS
+                              // count these, so changing the rate changes how long they take
+#define TASK_MOTION_HZ 100    // servo moves, queued operations and saving settings
+#define TASK_BUTTON_HZ 100    // button debounce and gate selection
+#define TASK_LED_HZ 10        // error flash and serial commands
+
+// Log - DPRINT and friends print into this many bytes of RAM (a power of two up to 256) and loop()
+// sends them as the serial port has room. Messages that don't fit are dropped and counted.
+#define LOG_BUFFER_SIZE 128
+
+// Telemetry - compact binary event frames on the serial port instead of DEBUG text, cheap enough
+// to leave on in production. Read them with tools/decode_telemetry.py (or use the uno-telemetry environment)
+#ifndef ENABLE_TELEMETRY
+#define ENABLE_TELEMETRY false
+#endif
+#define TELEMETRY_BAUD 250000  // Serial speed when telemetry is on, frames that don't fit the transmit buffer are dropped
+
+// Trace capture - the uno-trace environment (-DTRACE_CAPTURE) streams raw sensor samples over
+// serial for tools/capture_trace.py instead of running the gates, see tools/replay
+#define TRACE_BAUD 250000  // Serial speed while capturing, must keep up with ADC_SAMPLE_RATE_HZ
 
 // Flutter Protection Settings
 #define AC_SENSOR_SENSITIVITY_ON  2.0  // Threshold to turn tool ON (same as AC_SENSOR_SENSITIVITY for backward compatibility)
@@ -42,6 +131,16 @@
 #define MAX_OPS_PER_MINUTE        10   // Maximum operations per minute before emergency shutdown
 #define ERROR_FLASH_INTERVAL_MS   200  // LED flash interval in error state (milliseconds)
 
+// Fast trigger - open a gate as soon as its tool's motor inrush shows instead of waiting for the averaged,
+// debounced detection above, which closes the gate again if it hasn't confirmed the tool within
+// FAST_TRIGGER_CONFIRM_MS. Gate operations still go through the flutter protection limits.
+#ifndef ENABLE_FAST_TRIGGER
+#define ENABLE_FAST_TRIGGER false
+#endif
+#define FAST_TRIGGER_SENSITIVITY 4.0   // a window of DETECT_WINDOW_CYCLES mains cycles this many times the off baseline,
+                                       // straight after one below the on threshold, is an inrush
+#define FAST_TRIGGER_CONFIRM_MS  3000  // how long the averaged detection has to confirm a fast opened gate
+
 
 // Blink timing for meter mode (in milliseconds)
 #ifdef DEBUG
@@ -50,7 +149,8 @@
 #define MAX_BLINK_LEN 200 // normal blink rate in release mode
 #endif
 
-// Servo Pins
+// Servo Pins (PCA9685 channels with SERVO_BACKEND_PCA9685)
+// Gates 9-16 need SERVO_BACKEND_PCA9685, the Uno doesn't have the pins to drive that many servos directly
 #define SERVO_PIN_1 12 // Pin for first blast gate servo
 #define SERVO_PIN_2 -1 // ...etc..
 #define SERVO_PIN_3 11
@@ -59,6 +159,14 @@
 #define SERVO_PIN_6 -1
 #define SERVO_PIN_7 -1
 #define SERVO_PIN_8 -1
+#define SERVO_PIN_9 -1
+#define SERVO_PIN_10 -1
+#define SERVO_PIN_11 -1
+#define SERVO_PIN_12 -1
+#define SERVO_PIN_13 -1
+#define SERVO_PIN_14 -1
+#define SERVO_PIN_15 -1
+#define SERVO_PIN_16 -1
 
 // AC Sensor Pins
 #define AC_SENSOR_PIN_1 A0 // Pin for first AC sensor
@@ -69,6 +177,14 @@
 #define AC_SENSOR_PIN_6 -1
 #define AC_SENSOR_PIN_7 -1
 #define AC_SENSOR_PIN_8 -1
+#define AC_SENSOR_PIN_9 -1
+#define AC_SENSOR_PIN_10 -1
+#define AC_SENSOR_PIN_11 -1
+#define AC_SENSOR_PIN_12 -1
+#define AC_SENSOR_PIN_13 -1
+#define AC_SENSOR_PIN_14 -1
+#define AC_SENSOR_PIN_15 -1
+#define AC_SENSOR_PIN_16 -1
 
 // Gate orientation configuration
 // Set to true if gate is closed when servo is at max position (default)
@@ -81,6 +197,14 @@
 #define GATE_CLOSED_AT_MAX_6 false
 #define GATE_CLOSED_AT_MAX_7 false
 #define GATE_CLOSED_AT_MAX_8 false
+#define GATE_CLOSED_AT_MAX_9 false
+#define GATE_CLOSED_AT_MAX_10 false
+#define GATE_CLOSED_AT_MAX_11 false
+#define GATE_CLOSED_AT_MAX_12 false
+#define GATE_CLOSED_AT_MAX_13 false
+#define GATE_CLOSED_AT_MAX_14 false
+#define GATE_CLOSED_AT_MAX_15 false
+#define GATE_CLOSED_AT_MAX_16 false
 
 // Servo Max positions (180 degrees)
 // It's ok to leave at default and for the servo to try to go too far but it will increase the power load
@@ -93,6 +217,14 @@
 #define SERVO_MAX_6 -1
 #define SERVO_MAX_7 -1
 #define SERVO_MAX_8 -1
+#define SERVO_MAX_9 -1
+#define SERVO_MAX_10 -1
+#define SERVO_MAX_11 -1
+#define SERVO_MAX_12 -1
+#define SERVO_MAX_13 -1
+#define SERVO_MAX_14 -1
+#define SERVO_MAX_15 -1
+#define SERVO_MAX_16 -1
 
 // Servo Min positions (0 degrees)
 // It's ok to leave at default and for the servo to try to go too far but it will increase the power load
@@ -105,6 +237,53 @@
 #define SERVO_MIN_6 -1
 #define SERVO_MIN_7 -1
 #define SERVO_MIN_8 -1
+#define SERVO_MIN_9 -1
+#define SERVO_MIN_10 -1
+#define SERVO_MIN_11 -1
+#define SERVO_MIN_12 -1
+#define SERVO_MIN_13 -1
+#define SERVO_MIN_14 -1
+#define SERVO_MIN_15 -1
+#define SERVO_MIN_16 -1
+
+// Servo motion profile - each move speeds up at SERVO_ACCEL_ degrees per second per second to at most
+// SERVO_SPEED_ degrees per second and slows down the same way into its target, instead of the servo
+// slamming across at full speed. Gentler moves draw less peak current and are easier on the gates.
+// Set a gate's speed to 0 to send it straight to its target. The profile steps at TASK_MOTION_HZ.
+//
+#define SERVO_SPEED_1 250
+#define SERVO_SPEED_2 250
+#define SERVO_SPEED_3 250
+#define SERVO_SPEED_4 250
+#define SERVO_SPEED_5 250
+#define SERVO_SPEED_6 250
+#define SERVO_SPEED_7 250
+#define SERVO_SPEED_8 250
+#define SERVO_SPEED_9 250
+#define SERVO_SPEED_10 250
+#define SERVO_SPEED_11 250
+#define SERVO_SPEED_12 250
+#define SERVO_SPEED_13 250
+#define SERVO_SPEED_14 250
+#define SERVO_SPEED_15 250
+#define SERVO_SPEED_16 250
+
+#define SERVO_ACCEL_1 1500
+#define SERVO_ACCEL_2 1500
+#define SERVO_ACCEL_3 1500
+#define SERVO_ACCEL_4 1500
+#define SERVO_ACCEL_5 1500
+#define SERVO_ACCEL_6 1500
+#define SERVO_ACCEL_7 1500
+#define SERVO_ACCEL_8 1500
+#define SERVO_ACCEL_9 1500
+#define SERVO_ACCEL_10 1500
+#define SERVO_ACCEL_11 1500
+#define SERVO_ACCEL_12 1500
+#define SERVO_ACCEL_13 1500
+#define SERVO_ACCEL_14 1500
+#define SERVO_ACCEL_15 1500
+#define SERVO_ACCEL_16 1500
 
 
 
@@ -117,6 +296,14 @@
 #define LED_PIN_6 -1
 #define LED_PIN_7 -1
 #define LED_PIN_8 -1
+#define LED_PIN_9 -1
+#define LED_PIN_10 -1
+#define LED_PIN_11 -1
+#define LED_PIN_12 -1
+#define LED_PIN_13 -1
+#define LED_PIN_14 -1
+#define LED_PIN_15 -1
+#define LED_PIN_16 -1
 
 
 #endif // CONFIGURATION_H
@@ -1,12 +1,56 @@
 #ifndef DEBUG_H
 #define DEBUG_H
 
-#ifdef DEBUG    //Macros are usually in all capital letters.
-  #define DPRINT(...)    Serial.print(__VA_ARGS__)     //DPRINT is a macro, debug print
-  #define DPRINTLN(...)  Serial.println(__VA_ARGS__)   //DPRINTLN is a macro, debug print with new line
+#include "Logger.h"
+
+// Log levels, messages above LOG_LEVEL are left out of the build
+#define LOG_LEVEL_NONE  0
+#define LOG_LEVEL_ERROR 1   // the system has stopped or can't do what it was asked
+#define LOG_LEVEL_WARN  2   // something is wrong but it carries on
+#define LOG_LEVEL_INFO  3   // startup, calibration, tools and gates changing state
+#define LOG_LEVEL_DEBUG 4   // everything else
+
+// Everything with DEBUG, nothing without it. Set LOG_LEVEL in platformio.ini to pick another level.
+#ifndef LOG_LEVEL
+  #ifdef DEBUG
+  #define LOG_LEVEL LOG_LEVEL_DEBUG
+  #else
+  #define LOG_LEVEL LOG_LEVEL_NONE
+  #endif
+#endif
+
+// All of these print through the buffered Log. Wrap string literals in F() so they stay in flash.
+// Left out they are still a statement, so `if (x) DPRINTLN(...);` compiles without an empty body.
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+  #define EPRINT(...)    Log.print(__VA_ARGS__)     //EPRINT is a macro, error print
+  #define EPRINTLN(...)  Log.println(__VA_ARGS__)   //EPRINTLN is a macro, error print with new line
+#else
+  #define EPRINT(...)    do {} while (0)
+  #define EPRINTLN(...)  do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+  #define WPRINT(...)    Log.print(__VA_ARGS__)     //WPRINT is a macro, warning print
+  #define WPRINTLN(...)  Log.println(__VA_ARGS__)
+#else
+  #define WPRINT(...)    do {} while (0)
+  #define WPRINTLN(...)  do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+  #define IPRINT(...)    Log.print(__VA_ARGS__)     //IPRINT is a macro, info print
+  #define IPRINTLN(...)  Log.println(__VA_ARGS__)
+#else
+  #define IPRINT(...)    do {} while (0)
+  #define IPRINTLN(...)  do {} while (0)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+  #define DPRINT(...)    Log.print(__VA_ARGS__)     //DPRINT is a macro, debug print
+  #define DPRINTLN(...)  Log.println(__VA_ARGS__)   //DPRINTLN is a macro, debug print with new line
 #else
-  #define DPRINT(...)     //now defines a blank line
-  #define DPRINTLN(...)   //now defines a blank line
+  #define DPRINT(...)    do {} while (0)
+  #define DPRINTLN(...)  do {} while (0)
 #endif
 
 #endif // DEBUG_H
@@ -0,0 +1,87 @@
+/*
+  FastPin.h - Direct port register access for the LED and button pins
+  Released into the public domain.
+*/
+#ifndef FastPin_h
+#define FastPin_h
+
+#include "Arduino.h"
+
+  // digitalWrite() and digitalRead() look the pin up in three flash tables
+  // and check for PWM on every call, several microseconds each. On the Uno
+  // the port and bit of a pin are fixed (D0-D7 = PORTD, D8-D13 = PORTB,
+  // A0-A5 = PORTC), so they can be worked out at compile time:
+  //   write<pin>() / read<pin>()  a pin known at compile time, one sbi/cbi/sbic instruction
+  //   write(port, mask, pin, on)  a pin looked up at run time (GateConfig keeps its port and mask)
+  //   writePort(port, mask, on)   several pins on one port with a single write
+  // Other boards and the host build fall back to digitalWrite()/digitalRead().
+  #if defined(__AVR_ATmega328P__)
+  #define FAST_PIN_IO 1
+  #else
+  #define FAST_PIN_IO 0
+  #endif
+
+  class FastPin {
+    public:
+      enum { PORT_NONE, PORT_B, PORT_C, PORT_D };
+
+      static constexpr uint8_t portOf(int pin)
+      {
+        return pin < 0 ? PORT_NONE : pin < 8 ? PORT_D : pin < 14 ? PORT_B : pin < 20 ? PORT_C : PORT_NONE;
+      }
+
+      static constexpr uint8_t maskOf(int pin)
+      {
+        return portOf(pin) == PORT_NONE ? 0 : (uint8_t)(1 << (pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14));
+      }
+
+      template <int pin> static void write(bool high)
+      {
+        #if FAST_PIN_IO
+        if (portOf(pin) == PORT_NONE) return;
+        if (high) out(portOf(pin)) |= maskOf(pin);    // single bit of a low I/O register, sbi/cbi are atomic
+        else out(portOf(pin)) &= ~maskOf(pin);
+        #else
+        digitalWrite(pin, high ? HIGH : LOW);
+        #endif
+      }
+
+      template <int pin> static int read()
+      {
+        #if FAST_PIN_IO
+        if (portOf(pin) == PORT_NONE) return HIGH;   // no pin, reads as an unpressed pull-up
+        return (in(portOf(pin)) & maskOf(pin)) ? HIGH : LOW;
+        #else
+        return digitalRead(pin);
+        #endif
+      }
+
+      static void write(uint8_t port, uint8_t mask, int pin, bool high)
+      {
+        #if FAST_PIN_IO
+        (void)pin;
+        writePort(port, mask, high);
+        #else
+        digitalWrite(pin, high ? HIGH : LOW);
+        #endif
+      }
+
+      #if FAST_PIN_IO
+      static void writePort(uint8_t port, uint8_t mask, bool high)
+      {
+        if (!mask) return;
+        // The Servo interrupt writes pins on the same ports, keep it out of the read-modify-write
+        uint8_t sreg = SREG;
+        cli();
+        if (high) out(port) |= mask;
+        else out(port) &= ~mask;
+        SREG = sreg;
+      }
+
+    private:
+      static volatile uint8_t &out(uint8_t port) { return port == PORT_B ? PORTB : port == PORT_C ? PORTC : PORTD; }
+      static volatile uint8_t &in(uint8_t port)  { return port == PORT_B ? PINB : port == PORT_C ? PINC : PIND; }
+      #endif
+  };
+
+#endif
@@ -0,0 +1,107 @@
+/*
+  GateConfig.h - Compile time table of each gate's pins and servo positions
+  Released into the public domain.
+*/
+#ifndef GateConfig_h
+#define GateConfig_h
+
+#include "Arduino.h"
+#include <Servo.h>
+#include "Configuration.h"
+#include "FastPin.h"
+
+  // Gate n (numbered from 0) has the servo, LED and AC sensor set by the
+  // SERVO_PIN_, LED_PIN_ and AC_SENSOR_PIN_ settings numbered n + 1. The
+  // table is built from Configuration.h by the compiler and lives in flash,
+  // so nothing about a gate's wiring takes SRAM. The open and close
+  // positions are worked out from SERVO_MIN_, SERVO_MAX_ and
+  // GATE_CLOSED_AT_MAX_ when the table is built, and the SERVO_SPEED_ and
+  // SERVO_ACCEL_ motion profile limits are turned into servo pulse steps per
+  // motion task tick.
+  class GateConfig {
+    public:
+      static const int max_gates = 16;
+      // Rows in use, enough for every configured gate, sensor and LED
+      static const int count = NUM_GATES > NUM_AC_SENSORS ? (NUM_GATES > NUM_LEDS ? NUM_GATES : NUM_LEDS)
+                                                         : (NUM_AC_SENSORS > NUM_LEDS ? NUM_AC_SENSORS : NUM_LEDS);
+
+      struct Row {
+        int8_t servoPin;          // -1 = no servo
+        int8_t ledPin;            // -1 = no LED
+        int8_t sensorPin;         // -1 = no AC sensor
+        uint8_t ledPort;          // FastPin port and bit of the LED
+        uint8_t ledMask;
+        int16_t openPosition;     // servo position with the gate open
+        int16_t closePosition;    // servo position with the gate closed
+        uint16_t maxStep;         // most the pulse moves in one motion tick, 1/256 us (0 = no profile, at most 0x7fff)
+        uint16_t accelStep;       // most maxStep changes by in one motion tick, 1/256 us
+      };
+
+      // Profile limits in 1/256 us of servo pulse per motion tick
+      static const int profile_shift = 8;
+      static constexpr long pulseStep(long degreesPerSecond)
+      {
+        return degreesPerSecond * (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH) * (1L << profile_shift) / 180 / TASK_MOTION_HZ;
+      }
+
+      static constexpr Row row(int servoPin, int ledPin, int sensorPin, int servoMax, int servoMin, bool closedAtMax, long speed, long accel)
+      {
+        return Row{ (int8_t)servoPin, (int8_t)ledPin, (int8_t)sensorPin, FastPin::portOf(ledPin), FastPin::maskOf(ledPin),
+                    (int16_t)(closedAtMax ? servoMin : servoMax), (int16_t)(closedAtMax ? servoMax : servoMin),
+                    (uint16_t)(pulseStep(speed) > 0x7fff ? 0x7fff : pulseStep(speed)),
+                    (uint16_t)(pulseStep(accel) / TASK_MOTION_HZ < 1 ? 1 : pulseStep(accel) / TASK_MOTION_HZ) };
+      }
+
+      static int servoPin(int gate)  { return (int8_t)pgm_read_byte(&table[gate].servoPin); }
+      static int ledPin(int gate)    { return (int8_t)pgm_read_byte(&table[gate].ledPin); }
+      static int sensorPin(int gate) { return (int8_t)pgm_read_byte(&table[gate].sensorPin); }
+      static int openPosition(int gate)  { return (int16_t)pgm_read_word(&table[gate].openPosition); }
+      static int closePosition(int gate) { return (int16_t)pgm_read_word(&table[gate].closePosition); }
+      static long maxStep(int gate)      { return pgm_read_word(&table[gate].maxStep); }
+      static long accelStep(int gate)    { return pgm_read_word(&table[gate].accelStep); }
+
+      static void writeLed(int gate, bool on)
+      {
+        FastPin::write(pgm_read_byte(&table[gate].ledPort), pgm_read_byte(&table[gate].ledMask), ledPin(gate), on);
+      }
+
+      // Bits of the given FastPin port driving the LEDs of the first NUM_GATES gates
+      static constexpr uint8_t gateLedsOnPort(uint8_t port)
+      {
+        return ledOnPort(port, LED_PIN_1, 0) | ledOnPort(port, LED_PIN_2, 1) | ledOnPort(port, LED_PIN_3, 2) | ledOnPort(port, LED_PIN_4, 3) |
+               ledOnPort(port, LED_PIN_5, 4) | ledOnPort(port, LED_PIN_6, 5) | ledOnPort(port, LED_PIN_7, 6) | ledOnPort(port, LED_PIN_8, 7) |
+               ledOnPort(port, LED_PIN_9, 8) | ledOnPort(port, LED_PIN_10, 9) | ledOnPort(port, LED_PIN_11, 10) | ledOnPort(port, LED_PIN_12, 11) |
+               ledOnPort(port, LED_PIN_13, 12) | ledOnPort(port, LED_PIN_14, 13) | ledOnPort(port, LED_PIN_15, 14) | ledOnPort(port, LED_PIN_16, 15);
+      }
+
+      // True if any configured sensor or LED, or the servo current input, is on the given pin
+      static constexpr bool pinInUse(int pin)
+      {
+        return pin == SERVO_CURRENT_PIN ||
+               sensorOn(pin, AC_SENSOR_PIN_1, 0) || sensorOn(pin, AC_SENSOR_PIN_2, 1) || sensorOn(pin, AC_SENSOR_PIN_3, 2) ||
+               sensorOn(pin, AC_SENSOR_PIN_4, 3) || sensorOn(pin, AC_SENSOR_PIN_5, 4) || sensorOn(pin, AC_SENSOR_PIN_6, 5) ||
+               sensorOn(pin, AC_SENSOR_PIN_7, 6) || sensorOn(pin, AC_SENSOR_PIN_8, 7) || sensorOn(pin, AC_SENSOR_PIN_9, 8) ||
+               sensorOn(pin, AC_SENSOR_PIN_10, 9) || sensorOn(pin, AC_SENSOR_PIN_11, 10) || sensorOn(pin, AC_SENSOR_PIN_12, 11) ||
+               sensorOn(pin, AC_SENSOR_PIN_13, 12) || sensorOn(pin, AC_SENSOR_PIN_14, 13) || sensorOn(pin, AC_SENSOR_PIN_15, 14) ||
+               sensorOn(pin, AC_SENSOR_PIN_16, 15) ||
+               (gateLedsOnPort(FastPin::portOf(pin)) & FastPin::maskOf(pin)) != 0;
+      }
+
+    private:
+      static const Row table[max_gates];     // in flash, see GateConfig.cpp
+
+      static constexpr uint8_t ledOnPort(uint8_t port, int pin, int gate)
+      {
+        return gate < NUM_GATES && FastPin::portOf(pin) == port ? FastPin::maskOf(pin) : 0;
+      }
+
+      static constexpr bool sensorOn(int pin, int sensorPin, int sensor)
+      {
+        return sensor < NUM_AC_SENSORS && sensorPin == pin;
+      }
+  };
+
+  static_assert(NUM_GATES <= GateConfig::max_gates && NUM_AC_SENSORS <= GateConfig::max_gates && NUM_LEDS <= GateConfig::max_gates,
+                "Configuration.h only has settings for 16 gates");
+
+#endif
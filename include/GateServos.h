@@ -7,71 +7,24 @@
 #define GateServo_h
 
 #include "Arduino.h"
-#include <Servo.h>
 #include "Debug.h"
 #include "Configuration.h"
+#include "GateConfig.h"
+#include "ServoBackend.h"
 
   class GateServos {
-    static const int num_servos = NUM_GATES;
-    static const int num_leds = NUM_LEDS;
-    static const int servo_pin_1 = SERVO_PIN_1;
-    static const int servo_pin_2 = SERVO_PIN_2; 
-    static const int servo_pin_3 = SERVO_PIN_3;
-    static const int servo_pin_4 = SERVO_PIN_4;
-    static const int servo_pin_5 = SERVO_PIN_5;
-    static const int servo_pin_6 = SERVO_PIN_6;
-    static const int servo_pin_7 = SERVO_PIN_7;
-    static const int servo_pin_8 = SERVO_PIN_8;
-
-    static const bool gate_closed_at_max_1 = GATE_CLOSED_AT_MAX_1;
-    static const bool gate_closed_at_max_2 = GATE_CLOSED_AT_MAX_2;
-    static const bool gate_closed_at_max_3 = GATE_CLOSED_AT_MAX_3;
-    static const bool gate_closed_at_max_4 = GATE_CLOSED_AT_MAX_4;
-    static const bool gate_closed_at_max_5 = GATE_CLOSED_AT_MAX_5;
-    static const bool gate_closed_at_max_6 = GATE_CLOSED_AT_MAX_6;
-    static const bool gate_closed_at_max_7 = GATE_CLOSED_AT_MAX_7;
-    static const bool gate_closed_at_max_8 = GATE_CLOSED_AT_MAX_8;
-
-    static const int servo_max_1 = SERVO_MAX_1;
-    static const int servo_max_2 = SERVO_MAX_2;
-    static const int servo_max_3 = SERVO_MAX_3;
-    static const int servo_max_4 = SERVO_MAX_4;
-    static const int servo_max_5 = SERVO_MAX_5;
-    static const int servo_max_6 = SERVO_MAX_6;
-    static const int servo_max_7 = SERVO_MAX_7;
-    static const int servo_max_8 = SERVO_MAX_8;
-
-    static const int servo_min_1 = SERVO_MIN_1;
-    static const int servo_min_2 = SERVO_MIN_2;
-    static const int servo_min_3 = SERVO_MIN_3;
-    static const int servo_min_4 = SERVO_MIN_4;
-    static const int servo_min_5 = SERVO_MIN_5;
-    static const int servo_min_6 = SERVO_MIN_6;
-    static const int servo_min_7 = SERVO_MIN_7;
-    static const int servo_min_8 = SERVO_MIN_8;
-
-    static const int led_pin_1 = LED_PIN_1;
-    static const int led_pin_2 = LED_PIN_2;
-    static const int led_pin_3 = LED_PIN_3;
-    static const int led_pin_4 = LED_PIN_4;
-    static const int led_pin_5 = LED_PIN_5;
-    static const int led_pin_6 = LED_PIN_6;
-    static const int led_pin_7 = LED_PIN_7;
-    static const int led_pin_8 = LED_PIN_8;
+    static const int gate_rows = GateConfig::count;   // per gate state covers every gate, sensor and LED
     static const int closedelay = CLOSE_DELAY;
+    static const int settledelay = SERVO_SETTLE_MS;
+    static const int maxConcurrentServos = MAX_CONCURRENT_SERVOS;
+    static const int servoCurrentPin = SERVO_CURRENT_PIN;
     
     // Flutter protection constants
     static const unsigned long minServoInterval = MIN_SERVO_INTERVAL_MS;
     static const int maxOpsPerMinute = MAX_OPS_PER_MINUTE;
 
-    const int servopin[8] = {servo_pin_1,servo_pin_2,servo_pin_3,servo_pin_4,servo_pin_5,servo_pin_6,servo_pin_7,servo_pin_8};
-    const int maxservo[8] = {servo_max_1,servo_max_2,servo_max_3,servo_max_4,servo_max_5,servo_max_6,servo_max_7,servo_max_8};
-    const int minservo[8] = {servo_min_1,servo_min_2,servo_min_3,servo_min_4,servo_min_5,servo_min_6,servo_min_7,servo_min_8};
-    const int ledpin[8] = {led_pin_1,led_pin_2,led_pin_3,led_pin_4,led_pin_5,led_pin_6,led_pin_7,led_pin_8}; // LED pins
-    const bool gateClosedAtMax[8] = {gate_closed_at_max_1,gate_closed_at_max_2,gate_closed_at_max_3,gate_closed_at_max_4,gate_closed_at_max_5,gate_closed_at_max_6,gate_closed_at_max_7,gate_closed_at_max_8}; // Gate orientation
-
     // Flutter protection state tracking
-    unsigned long lastOperationTime[8] = {0, 0, 0, 0, 0, 0, 0, 0}; // Last operation timestamp per gate
+    unsigned long lastOperationTime[gate_rows] = {}; // Last operation timestamp per gate
     unsigned long operationTimes[MAX_OPS_PER_MINUTE]; // Circular buffer of operation timestamps
     int operationIndex = 0; // Current index in operation times buffer
     bool errorState = false; // System error state flag
@@ -83,31 +36,75 @@
       unsigned long requestTime;
       bool pending;
     };
-    QueuedOperation queuedOps[8]; // One queued operation per gate
+    QueuedOperation queuedOps[gate_rows]; // One queued operation per gate
     
-    Servo myservo;  // create servo object to control a servo
-             // a maximum of eight servo objects can be created
+    ServoBackend servos;     // one PWM channel per gate, only driven while the gate moves
+
+    // Non-blocking motion engine state
+    // A gate is ATTACHING while it waits for a free slot in the servo budget, MOVING while
+    // its servo travels, SETTLING while it is held before being detached, then back to IDLE.
+    // At most maxConcurrentServos gates are MOVING or SETTLING at once.
+    enum MotionState { MOTION_IDLE, MOTION_ATTACHING, MOTION_MOVING, MOTION_SETTLING };
+    MotionState motionState[gate_rows] = {};       // all MOTION_IDLE
+    int motionTarget[gate_rows];                  // servo position each gate is being driven to
+    unsigned int motionDuration[gate_rows];       // ms the servo needs to travel to the target
+    unsigned long motionStartTime[gate_rows];     // when the current motion state was entered
+    bool homing[gate_rows] = {};                  // LED lit until homing move completes
+    long profilePulse[gate_rows];                 // pulse being sent to each attached servo, 1/256 us
+    long profileVelocity[gate_rows];              // change in profilePulse per motion tick, signed
+    int motionQueue[gate_rows];                   // gates waiting for a servo slot, oldest first
+    int motionQueueLen = 0;
+    int attachedCount = 0;                        // gates MOVING or SETTLING, never above maxConcurrentServos
+
+    // Make before break gate swap: swapFrom stays open until swapTo is partly open
+    int swapFrom = -1;                            // gate to close once the swap gate is far enough open (-1 for none)
+    int swapTo = -1;
+    unsigned int swapOverlapMs = 0;               // how far into swapTo's opening move swapFrom starts closing
+
+    void startMotion(int gatenum, int position, unsigned int duration); // Queue a move, or retarget one in progress
+    void setPosition(int gatenum, uint8_t position); // Update gateposition and flag the change for saving
+    void updateSwap();                               // Close the old gate of a swap once the new one is partly open
+    bool stepProfile(int gatenum);                   // Move a servo one tick along its profile, true once it is at the target
+    unsigned int openTime(int gatenum);              // Measured open travel time, or opendelay
+    unsigned int closeTime(int gatenum);             // Measured close travel time, or closedelay
+    long timeMove(int gatenum, int position, int holding); // Profiled move timed by the servo current, blocking
+    static int readServoCurrent(int samples);        // Average of a few readings of SERVO_CURRENT_PIN
+    static long targetPulse(int position);           // Servo pulse for a position in degrees, 1/256 us
+    static int swapOverlapPercent(int from, int to); // SWAP_OVERLAP_PERCENT or the pair's own setting
     
     public:
       GateServos(int curopengate);  // initialize indicating currenly open gate (usually -1 for none)
       void opengate(int gatenum);   // open the given gate number
       void closegate(int gatenum);  // close the given gate number
-      void initializeGates();       // initialize gates and close them all
+      void initializeGates(const uint8_t *savedPositions = NULL); // initialize gates and close them all, skipping gates saved as closed
       void ledoff(int gatenum);     // turn off given LED
       void ledon(int gatenum);      // turn on given LED
+      void allLeds(bool on);        // turn every gate's LED on or off at once
       void ManuallyOpenGate(int gatenum);   // User manually opening given gate using the button
       int firstgateopen();                  // Returns ID of first gate that is open
-      void testServo(int servopin);         // Test given servo pin (debug function)
+      void testServo(int gatenum);          // Swing the given gate's servo end to end (debug function)
       bool checkOperationAllowed(int gatenum); // Check if operation is allowed (flutter protection)
       void recordOperation(int gatenum);    // Record an operation for rate limiting
       bool isInErrorState();                // Check if system is in error state
       void queueOperation(int gatenum, bool isOpen); // Queue an operation for delayed execution
       void processQueuedOperations();       // Process any pending queued operations
+      void updateMotion();                  // Advance servo motions, call every loop
+      bool isMotionIdle();                  // True when no gate is moving or waiting to move
+      bool measureTravel(int gatenum);      // Time a gate's open and close moves from the servo current, blocks for a few seconds
       const int num_gates = NUM_GATES;      //
       int curopengate = -1;                 // cuurrently open gate selected manually with button
       const unsigned long opendelay = OPEN_DELAY;     // ms delay to allow servo to completely open gate
-      bool gateopen[8] = {false, false, false, false,false, false, false, false};   // array indicating which gates are open
+      bool gateopen[gate_rows] = {};        // array indicating which gates are open
       bool isGateDisabled(int gatenum);     // Check if a gate is disabled (servo pin = -1)
+
+      // Last known physical position of each gate, kept so a warm boot can skip homing
+      enum { GATE_POSITION_UNKNOWN = 0, GATE_POSITION_CLOSED = 1, GATE_POSITION_OPEN = 2 };
+      uint8_t gateposition[NUM_GATES];
+      bool positionsChanged = false;        // set when a gate moves onto or off closed, cleared by whoever saves it
+
+      // Measured travel time of each gate's moves in ms, 0 = not measured, use OPEN_DELAY / CLOSE_DELAY
+      uint16_t travelOpenMs[NUM_GATES] = {};
+      uint16_t travelCloseMs[NUM_GATES] = {};
   };
   
 
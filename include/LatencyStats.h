@@ -0,0 +1,44 @@
+/*
+  LatencyStats.h - Times each stage from a tool starting to its gate being open
+  Released into the public domain.
+*/
+#ifndef LatencyStats_h
+#define LatencyStats_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+
+  // Each sensor drives the gate with the same number, so one event per gate
+  // runs from the first sample above the on threshold to the servo reaching
+  // the open position. The onset to open time goes into a per-gate histogram
+  // and each stage into shared totals, all kept in RAM until cleared. The
+  // serial commands in BlastGateServo.cpp print them with dump(). Bucket
+  // counts are a byte each and stop at 255.
+  class LatencyStats {
+    public:
+      enum Stage {
+        STAGE_ONSET,         // first sample above the on threshold (AcSensors::ReadSensors)
+        STAGE_DETECTED,      // debounce committed the tool on (AcSensors::updateSensorState)
+        STAGE_COMMANDED,     // GateServos::opengate() called
+        STAGE_ATTACHED,      // servo attached and sent to the open position
+        STAGE_OPEN,          // servo move time elapsed, gate open
+        num_stages
+      };
+      static const int num_buckets = 14;
+
+      #if ENABLE_LATENCY_STATS
+      static void onset(int gate, unsigned long atMs);  // start an event unless one is running
+      static void mark(int gate, Stage stage);          // an event reached a stage now, STAGE_OPEN finishes it
+      static void cancel(int gate);                     // the tool went quiet or off before the gate opened
+      static void clear();                              // forget everything recorded
+      static void dump(Print &out);                     // print histograms, p50/p99 and stage averages
+      #else
+      static void onset(int, unsigned long) {}
+      static void mark(int, Stage) {}
+      static void cancel(int) {}
+      static void clear() {}
+      static void dump(Print &out) { out.println(F("Latency statistics are off (ENABLE_LATENCY_STATS)")); }
+      #endif
+  };
+
+#endif
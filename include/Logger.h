@@ -0,0 +1,35 @@
+/*
+  Logger.h - Buffered serial log that never stalls loop()
+  Released into the public domain.
+*/
+#ifndef Logger_h
+#define Logger_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+
+  // Log messages are printed into a LOG_BUFFER_SIZE byte ring and moved to
+  // the serial port by poll() only as fast as its transmit buffer empties,
+  // so a burst of messages costs the time to copy them, not the time to send
+  // them at 9600 baud. When the ring is full the rest of the message is
+  // dropped (the whole line if none of it has been sent yet) and a count of
+  // dropped messages is printed once there is room again.
+  //
+  // setup() runs with blocking on so nothing printed while starting up is
+  // lost, and turns it off before the first loop().
+  class Logger : public Print {
+    public:
+      void begin(unsigned long baud);       // open the serial port, starts in blocking mode
+      void setBlocking(bool wait);          // true = wait for room instead of dropping
+      void poll();                          // send what fits in the serial transmit buffer
+      size_t write(uint8_t c);
+      using Print::write;
+
+    private:
+      bool hasRoom();
+      void settle();
+  };
+
+  extern Logger Log;
+
+#endif
@@ -0,0 +1,44 @@
+/*
+  PackedSamples.h - Fixed size array of 10 bit ADC values packed 4 to 5 bytes
+  Released into the public domain.
+*/
+#ifndef PackedSamples_h
+#define PackedSamples_h
+
+#include "Arduino.h"
+
+  // Holds size values of 0 - 1023, the range of analogRead() and anything
+  // averaged from it, in 10 bits each instead of an int's 16. Every group of
+  // four values takes five bytes: the low 8 bits of each in the first four
+  // and the top 2 bits of all four in the fifth, so get() and set() only
+  // need a few shifts and masks. Starts out all zero.
+  template <int size>
+  class PackedSamples {
+    public:
+      static const int bytes = (size + 3) / 4 * 5;
+
+      int get(int index) const
+      {
+        const uint8_t *group = data + (index >> 2) * 5;
+        uint8_t shift = (index & 3) * 2;
+        return group[index & 3] | (((group[4] >> shift) & 0x03) << 8);
+      }
+
+      void set(int index, int value)
+      {
+        uint8_t *group = data + (index >> 2) * 5;
+        uint8_t shift = (index & 3) * 2;
+        group[index & 3] = value & 0xff;
+        group[4] = (group[4] & ~(0x03 << shift)) | (((value >> 8) & 0x03) << shift);
+      }
+
+      void clear()
+      {
+        for (int x = 0; x < bytes; x++) data[x] = 0;
+      }
+
+    private:
+      uint8_t data[bytes] = {};
+  };
+
+#endif
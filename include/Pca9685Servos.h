@@ -0,0 +1,49 @@
+/*
+  Pca9685Servos.h - Servo backend driving the gates from PCA9685 PWM boards over I2C
+  Released into the public domain.
+*/
+#ifndef Pca9685Servos_h
+#define Pca9685Servos_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+#include "GateConfig.h"
+
+  // Each gate's SERVO_PIN_ setting is a channel, 16 to a board, with the
+  // boards at PCA9685_ADDRESS on. The outputs run at 50 Hz and a servo
+  // pulse is its channel's OFF count, about 4.9 us a count. write(),
+  // attach() and detach() only change a copy of the channel registers
+  // kept in RAM. flush() sends each board's changed channels using the
+  // chip's register auto-increment, up to 7 neighbouring channels (29
+  // bytes, inside the Wire library's 32 byte buffer) in one transaction.
+  // Unchanged channels between two changed ones are sent again rather
+  // than starting another transaction. A detached channel is held fully
+  // off, so its servo goes limp as it does with the Servo library.
+  class Pca9685Servos {
+    public:
+      static const int boards = PCA9685_BOARDS;
+      static const int channels = 16;           // per board
+      static const long pwm_hz = 50;            // servo frame rate
+
+      void begin();                             // start the bus and set up every board with all channels off
+      void write(int gatenum, int pulseUs);     // pulse width in us, may be set before attach()
+      void attach(int gatenum);                 // start sending pulses to the gate's servo
+      void detach(int gatenum);                 // switch the channel off, the servo goes limp where it is
+      void flush();                             // send the changes made since the last flush
+
+    private:
+      static const int batch_channels = 7;      // most channels sent in one transaction
+      static const uint16_t full_off = 0x1000;  // OFF_H bit 4, output held low
+
+      uint16_t pulseCount[boards * channels] = {};  // OFF count of each channel while it is attached
+      uint16_t attached[boards] = {};               // bit per channel
+      uint16_t dirty[boards] = {};                  // channels changed since the last flush
+      bool busError = false;                        // a board didn't answer, reported once
+
+      static int channelOf(int gatenum);            // channel numbered across all boards, -1 for none
+      void writeRegister(int board, uint8_t reg, uint8_t value);
+      void sendChannels(int board, int first, int last);
+      void endTransaction(int board);
+  };
+
+#endif
@@ -0,0 +1,27 @@
+/*
+  PinServos.h - Servo backend driving each gate's servo from its own pin
+  Released into the public domain.
+*/
+#ifndef PinServos_h
+#define PinServos_h
+
+#include "Arduino.h"
+#include <Servo.h>
+#include "Configuration.h"
+#include "GateConfig.h"
+
+  // One Servo library channel per gate on its SERVO_PIN_ setting. Every
+  // call takes effect at once, so flush() has nothing to do.
+  class PinServos {
+    static const int gate_rows = GateConfig::count;
+    Servo servo[gate_rows];
+
+    public:
+      void begin() {}
+      void write(int gatenum, int pulseUs);   // pulse width in us, may be set before attach()
+      void attach(int gatenum);               // start sending pulses to the gate's servo
+      void detach(int gatenum);               // stop the pulses, the servo goes limp where it is
+      void flush() {}                         // send the changes made since the last flush
+  };
+
+#endif
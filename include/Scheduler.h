@@ -0,0 +1,50 @@
+/*
+  Scheduler.h - Cooperative scheduler running each job of loop() at its own rate
+  Released into the public domain.
+*/
+#ifndef Scheduler_h
+#define Scheduler_h
+
+#include "Arduino.h"
+
+  // Each task is a function with a period and a deadline in microseconds.
+  // run() starts the first task in the table that is due, so tasks added
+  // first have priority, and returns. When nothing is due it sleeps until
+  // the next interrupt (the millis() tick at the latest) instead of burning
+  // a fixed delay(). Tasks must not block, a slow task only delays the
+  // others and is counted as an overrun when it finishes past its deadline.
+  //
+  // A task that falls a whole period behind skips the releases it missed
+  // rather than running back to back to catch up.
+  class Scheduler {
+    public:
+      static const int max_tasks = 5;   // sample, motion, detect, button and leds, 26 bytes each on the Uno
+
+      typedef void (*TaskFunction)();
+
+      // Add a task, returns its number or -1 if the table is full. The first
+      // run is one period from now. deadlineUs 0 means the same as the period.
+      int add(const __FlashStringHelper *name, TaskFunction function, unsigned long periodUs, unsigned long deadlineUs = 0);
+      void run();                                         // run one due task, or sleep if none is due
+      void clearStats();                                  // forget the run counts and overruns recorded so far
+      void dump(Print &out);                              // print each task's period, runs, overruns and worst times
+
+    private:
+      struct Task {
+        TaskFunction function;
+        const __FlashStringHelper *name;
+        unsigned long periodUs;
+        unsigned long deadlineUs;          // must finish this long after it was due
+        unsigned long due;                 // micros() of the next release
+        unsigned long runs;
+        uint16_t overruns;                 // finished after the deadline
+        uint16_t worstLateUs;              // longest wait from due to start
+        uint16_t worstRunUs;               // longest run time
+      };
+      Task tasks[max_tasks];
+      int count = 0;
+
+      void idle(unsigned long now);
+  };
+
+#endif
@@ -0,0 +1,26 @@
+/*
+  ServoBackend.h - Selects what the gate servos are driven through
+  Released into the public domain.
+*/
+#ifndef ServoBackend_h
+#define ServoBackend_h
+
+#include "Configuration.h"
+
+  // GateServos drives its servos through a ServoBackend: begin() once, then
+  // write(gate, us), attach(gate) and detach(gate) as gates move, and
+  // flush() after each round of changes. PinServos acts on each call
+  // straight away. Pca9685Servos keeps the changes and flush() sends each
+  // board's in as few I2C transactions as it can. SERVO_BACKEND picks one
+  // at compile time, so a call costs no more than the Servo library did.
+  #if SERVO_BACKEND == SERVO_BACKEND_PCA9685
+  #include "Pca9685Servos.h"
+  typedef Pca9685Servos ServoBackend;
+  #elif SERVO_BACKEND == SERVO_BACKEND_PINS
+  #include "PinServos.h"
+  typedef PinServos ServoBackend;
+  #else
+  #error "SERVO_BACKEND must be SERVO_BACKEND_PINS or SERVO_BACKEND_PCA9685"
+  #endif
+
+#endif
@@ -0,0 +1,51 @@
+/*
+  SettingsStore.h - Sensor baselines, gate positions and travel times kept in EEPROM across power cycles
+  Released into the public domain.
+*/
+#ifndef SettingsStore_h
+#define SettingsStore_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+
+  class SettingsStore {
+    static const uint8_t record_magic = 0xB6;
+    static const uint8_t record_version = 2;
+    static const int record_address = SETTINGS_EEPROM_ADDRESS;
+
+    // Everything in the record must match the current configuration for it
+    // to be used, otherwise the controller falls back to a cold boot
+    struct Record {
+      uint8_t magic;
+      uint8_t version;
+      uint8_t numSensors;
+      uint8_t numGates;
+      uint8_t detectionMode;
+      uint8_t windowCycles;
+      uint16_t sampleRate;
+      uint8_t hasBaselines;
+      float offReadings[NUM_AC_SENSORS];
+      uint8_t gatePosition[NUM_GATES];
+      uint16_t travelOpenMs[NUM_GATES];     // measured by the m command, 0 = not measured
+      uint16_t travelCloseMs[NUM_GATES];
+      uint8_t crc;                          // CRC-8 of all the bytes above
+    };
+    Record record;
+
+    uint8_t crc8(const uint8_t *data, int len);
+    void write();                           // Update the record in EEPROM, only changed bytes are written
+
+    public:
+      SettingsStore();
+      bool load();                                      // Read the record, returns true if it is valid for this configuration
+      bool hasBaselines();                              // True if saved sensor baselines are available
+      const float *offReadings();                       // Saved sensor baselines
+      const uint8_t *gatePositions();                   // Saved gate positions (GateServos::GATE_POSITION_x)
+      void saveBaselines(const float *offReadings);     // Save sensor baselines
+      void saveGatePositions(const uint8_t *positions); // Save settled gate positions, skipped if none changed
+      const uint16_t *travelOpenMs();                   // Saved open travel time of each gate, 0 = not measured
+      const uint16_t *travelCloseMs();                  // Saved close travel time of each gate, 0 = not measured
+      void saveTravelTimes(const uint16_t *openMs, const uint16_t *closeMs); // Save measured travel times
+  };
+
+#endif
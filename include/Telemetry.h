@@ -0,0 +1,64 @@
+/*
+  Telemetry.h - Compact binary event log on the serial port
+  Released into the public domain.
+*/
+#ifndef Telemetry_h
+#define Telemetry_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+
+  // Each event is one frame: sync byte 0xA5, 'E', payload length, payload,
+  // checksum (low byte of the sum of 'E', length and payload). The payload is
+  // the event id, the low 16 bits of millis() and the event's arguments, little
+  // endian. With two or more arguments the first is a single byte. A TM_TIME
+  // event with the full millis() goes out whenever the high 16 bits change,
+  // so the decoder can rebuild absolute times.
+  //
+  // Frames are only written if they fit in the serial transmit buffer, so
+  // logging never blocks loop(). Frames that don't fit are counted and
+  // reported with the next TM_DROPPED event. tools/decode_telemetry.py turns
+  // the stream back into readable lines; its event table must match this one.
+  class Telemetry {
+    public:
+      enum Event {
+        TM_TIME,            // full millis() (uint32)
+        TM_BOOT,            // 1 = warm boot (int16)
+        TM_DROPPED,         // frames dropped since the last report (uint16)
+        TM_BASELINE,        // sensor (uint8), off reading x10 (int16)
+        TM_SENSOR_ON,       // sensor (uint8), reading x10 (int16), threshold x10 (int16)
+        TM_SENSOR_OFF,      // sensor (uint8), reading x10 (int16), threshold x10 (int16)
+        TM_GATE_OPEN,       // gate (uint8), servo position (int16)
+        TM_GATE_CLOSE,      // gate (uint8), servo position (int16)
+        TM_GATE_QUEUED,     // gate (uint8), 1 = open 0 = close (int16)
+        TM_MOVE_START,      // gate (uint8), target position (int16)
+        TM_MOVE_DONE,       // gate (int16)
+        TM_BUTTON,          // selected gate, -1 = all closed (int16)
+        TM_ERROR_STATE,     // operations in the last minute (int16)
+        TM_FAST_OPEN,       // gate opened on a motor inrush (int16)
+        TM_FAST_RETRACT,    // fast opened gate closed, the tool wasn't confirmed (int16)
+        TM_TRAVEL_TIME,     // gate (uint8), measured open ms (int16), close ms (int16), 0 = never settled
+        num_events
+      };
+
+      static const uint8_t frame_sync = 0xA5;
+      static const uint8_t frame_event = 'E';
+
+      #if ENABLE_TELEMETRY
+      static void begin();                                // open the serial port at TELEMETRY_BAUD
+      static void log(Event event);
+      static void log(Event event, int16_t value);
+      static void log(Event event, uint8_t index, int16_t value);
+      static void log(Event event, uint8_t index, int16_t value, int16_t extra);
+      static void logTime(unsigned long now);             // TM_TIME with the full clock
+      #endif
+  };
+
+  // Leave telemetry calls in the code at no cost when it is turned off
+  #if ENABLE_TELEMETRY
+  #define TLOG(...)  Telemetry::log(__VA_ARGS__)
+  #else
+  #define TLOG(...)  do {} while (0)
+  #endif
+
+#endif
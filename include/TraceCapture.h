@@ -0,0 +1,36 @@
+/*
+  TraceCapture.h - Streams raw AC sensor samples over serial for offline replay
+  Released into the public domain.
+*/
+#ifndef TraceCapture_h
+#define TraceCapture_h
+
+#include "Arduino.h"
+#include "Configuration.h"
+
+  // Capture builds (the uno-trace environment) do nothing but sample the
+  // sensors and send every sample to the serial port, where
+  // tools/capture_trace.py saves them for tools/replay.
+  //
+  // Every frame is: sync byte, type, payload length, payload, checksum
+  // (low byte of the sum of type, length and payload). Multi-byte values
+  // are little endian.
+  //   'H' header:  version, sensor count, active sensor mask (2 bytes), channel rate (2 bytes), mains Hz
+  //                (version 1 traces have a 1 byte mask)
+  //   'S' samples: sensor, sequence number of the first sample (4 bytes),
+  //                low byte of the sampler overrun count, samples (2 bytes each)
+  // A sample's time is its sequence number divided by the channel rate.
+  class TraceCapture {
+    public:
+      static const uint8_t frame_sync = 0xA5;
+      static const uint8_t frame_header = 'H';
+      static const uint8_t frame_samples = 'S';
+      static const uint8_t trace_version = 2;
+      static const int header_interval = 250;         // sample frames between repeated headers
+      static const int batch_size = 16;               // samples buffered per sensor before a frame is sent
+
+      static void begin();                            // open the serial port and start sampling the sensors
+      static void poll();                             // send the samples of every sensor with a full batch waiting
+  };
+
+#endif
@@ -0,0 +1,102 @@
+/*
+  Arduino.h - Host stand-in for the Arduino core used by the native build.
+  Time, pins, the ADC and the serial port are backed by the simulated shop in SimShop.h
+  Released into the public domain.
+*/
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 0x1
+#define LOW  0x0
+
+#define INPUT        0x0
+#define OUTPUT       0x1
+#define INPUT_PULLUP 0x2
+
+#define DEC 10
+#define HEX 16
+#define BIN 2
+
+#define PI 3.1415926535897932384626433832795
+
+// Uno analog pin numbers
+static const uint8_t A0 = 14;
+static const uint8_t A1 = 15;
+static const uint8_t A2 = 16;
+static const uint8_t A3 = 17;
+static const uint8_t A4 = 18;
+static const uint8_t A5 = 19;
+
+// No separate flash address space on the host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+
+void noInterrupts();
+void interrupts();
+
+void setup();
+void loop();
+
+  class Print {
+    size_t printNumber(unsigned long n, int base);
+    size_t printFloat(double number, int digits);
+
+    public:
+      virtual ~Print() {}
+      virtual size_t write(uint8_t c) = 0;
+      virtual size_t write(const uint8_t *buffer, size_t size);
+      size_t write(const char *str) { return str ? write((const uint8_t *)str, strlen(str)) : 0; }
+
+      size_t print(const __FlashStringHelper *str);
+      size_t print(const char *str);
+      size_t print(char c);
+      size_t print(unsigned char n, int base = DEC);
+      size_t print(int n, int base = DEC);
+      size_t print(unsigned int n, int base = DEC);
+      size_t print(long n, int base = DEC);
+      size_t print(unsigned long n, int base = DEC);
+      size_t print(double n, int digits = 2);
+
+      size_t println();
+      template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+      template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+  };
+
+  class HardwareSerial : public Print {
+    public:
+      void begin(unsigned long baud);
+      void end() {}
+      int available();
+      int read();
+      int availableForWrite();
+      void flush() {}
+      size_t write(uint8_t c);
+      using Print::write;
+      operator bool() { return true; }
+  };
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,33 @@
+/*
+  EEPROM.h - Host stand-in for the Arduino EEPROM library, backed by SimShop's EEPROM image
+  Released into the public domain.
+*/
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include "Arduino.h"
+#include "SimShop.h"
+
+  struct EEPROMClass {
+    uint8_t read(int idx) { return SimShop::eeprom[idx]; }
+    void write(int idx, uint8_t val) { SimShop::eeprom[idx] = val; SimShop::eepromWrites++; }
+    void update(int idx, uint8_t val) { if (read(idx) != val) write(idx, val); }
+    uint16_t length() { return SimShop::eeprom_size; }
+
+    template <typename T> T &get(int idx, T &t)
+    {
+      memcpy(&t, &SimShop::eeprom[idx], sizeof(T));
+      return t;
+    }
+
+    template <typename T> const T &put(int idx, const T &t)
+    {
+      const uint8_t *ptr = (const uint8_t *)&t;
+      for (size_t i = 0; i < sizeof(T); i++) update(idx + i, ptr[i]);
+      return t;
+    }
+  };
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,28 @@
+/*
+  Servo.h - Host stand-in for the Arduino Servo library, drives the simulated servos in SimShop.h
+  Released into the public domain.
+*/
+#ifndef Servo_h
+#define Servo_h
+
+#include "Arduino.h"
+
+#define MIN_PULSE_WIDTH 544
+#define MAX_PULSE_WIDTH 2400
+
+  class Servo {
+    int pin = -1;
+    int pulse = 1500;
+
+    public:
+      uint8_t attach(int pin);
+      uint8_t attach(int pin, int min, int max) { (void)min; (void)max; return attach(pin); }
+      void detach();
+      void write(int value);                // angle in degrees (values of 544 and up are microseconds)
+      void writeMicroseconds(int value);
+      int read();
+      int readMicroseconds() { return pulse; }
+      bool attached() { return pin != -1; }
+  };
+
+#endif
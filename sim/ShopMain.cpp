@@ -0,0 +1,199 @@
+/*
+  ShopMain.cpp - Runs the real setup() and loop() against the simulated shop
+  and reports how quickly gates follow the tools.
+
+  Usage: program [options]
+    --time S             simulated seconds to run (default 60)
+    --tool N:ON:OFF      tool on sensor N (1-based) runs from ON to OFF ms (repeatable)
+    --press MS[:LEN[:B]] press the button at MS for LEN ms (default 100) with B contact bounces
+                         on each edge (default 0) (repeatable)
+    --serial MS:TEXT     send TEXT to the serial port at MS (repeatable)
+    --eeprom FILE        load the EEPROM image from FILE and save it back on exit
+    --verbose            echo the firmware's serial output
+    --serial-out FILE    save the firmware's serial output to FILE, e.g. a TRACE_CAPTURE build's trace
+    --i2c-log FILE       list every I2C transaction in FILE (SERVO_BACKEND_PCA9685 builds)
+  With no --tool or --press options a default scenario is run.
+*/
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include "Arduino.h"
+#include "Configuration.h"
+#include "GateConfig.h"
+#include "SimShop.h"
+
+  struct ToolRun { int sensor; unsigned long on; unsigned long off; };
+  struct Press { unsigned long at; unsigned long length; int bounces; };
+
+  // First servo event of the given type on a pin at or after a time, -1 if none
+  static long long firstEvent(SimShop::EventType type, int pin, unsigned long long after)
+  {
+    for (size_t i = 0; i < SimShop::events.size(); i++) {
+      const SimShop::Event &e = SimShop::events[i];
+      if (e.type == type && e.pin == pin && e.time >= after) return (long long)e.time;
+    }
+    return -1;
+  }
+
+  // Last servo event of the given type on a pin between two times, -1 if none
+  static long long lastEvent(SimShop::EventType type, int pin, unsigned long long after, unsigned long long before)
+  {
+    long long last = -1;
+    for (size_t i = 0; i < SimShop::events.size(); i++) {
+      const SimShop::Event &e = SimShop::events[i];
+      if (e.type == type && e.pin == pin && e.time >= after && e.time <= before) last = (long long)e.time;
+    }
+    return last;
+  }
+
+  // One line per transaction: time in us, address, the bytes written and NACK if no device answered
+  static bool saveI2cLog(const char *path)
+  {
+    FILE *f = fopen(path, "w");
+    if (!f) return false;
+    for (size_t i = 0; i < SimShop::i2cLog.size(); i++) {
+      const SimShop::I2cTransaction &t = SimShop::i2cLog[i];
+      fprintf(f, "%llu 0x%02x", t.time, t.address);
+      for (size_t b = 0; b < t.data.size(); b++) fprintf(f, " %02x", t.data[b]);
+      fprintf(f, t.acked ? "\n" : " NACK\n");
+    }
+    fclose(f);
+    return true;
+  }
+
+  static void reportLatency(const char *what, int sensor, unsigned long at)
+  {
+    int pin = GateConfig::servoPin(sensor);
+    printf("  tool %d %s at %lu ms:", sensor + 1, what, at);
+    if (pin == -1) { printf(" gate has no servo\n"); return; }
+
+    long long commanded = firstEvent(SimShop::EV_SERVO_ATTACH, pin, at * 1000ULL);
+    if (commanded < 0) { printf(" gate never moved\n"); return; }
+    // A profiled move catches up with each step, the gate is in position at the last arrival before the detach
+    long long detached = firstEvent(SimShop::EV_SERVO_DETACH, pin, commanded);
+    long long arrived = lastEvent(SimShop::EV_SERVO_ARRIVED, pin, commanded, detached < 0 ? SimShop::clock : detached);
+    printf(" servo attached +%lld ms", commanded / 1000 - (long long)at);
+    if (arrived >= 0) printf(", gate in position +%lld ms", arrived / 1000 - (long long)at);
+    printf("\n");
+  }
+
+  int main(int argc, char **argv)
+  {
+    unsigned long runMs = 60000;
+    const char *eepromFile = NULL;
+    const char *i2cFile = NULL;
+    std::vector<ToolRun> tools;
+    std::vector<Press> presses;
+
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--time" && i + 1 < argc) {
+        runMs = (unsigned long)(atof(argv[++i]) * 1000);
+      } else if (arg == "--tool" && i + 1 < argc) {
+        ToolRun run;
+        if (sscanf(argv[++i], "%d:%lu:%lu", &run.sensor, &run.on, &run.off) != 3 || run.sensor < 1 || run.sensor > NUM_AC_SENSORS) {
+          fprintf(stderr, "bad --tool %s\n", argv[i]);
+          return 2;
+        }
+        run.sensor--;
+        tools.push_back(run);
+      } else if (arg == "--press" && i + 1 < argc) {
+        Press press = { 0, 100, 0 };
+        if (sscanf(argv[++i], "%lu:%lu:%d", &press.at, &press.length, &press.bounces) < 1) {
+          fprintf(stderr, "bad --press %s\n", argv[i]);
+          return 2;
+        }
+        presses.push_back(press);
+      } else if (arg == "--serial" && i + 1 < argc) {
+        std::string spec = argv[++i];
+        size_t colon = spec.find(':');
+        if (colon == std::string::npos) { fprintf(stderr, "bad --serial %s\n", spec.c_str()); return 2; }
+        SimShop::serialInput(strtoul(spec.c_str(), NULL, 10), spec.substr(colon + 1).c_str());
+      } else if (arg == "--jam" && i + 1 < argc) {
+        int gate;
+        unsigned long at;
+        if (sscanf(argv[++i], "%d:%lu", &gate, &at) != 2 || gate < 1 || gate > NUM_GATES || GateConfig::servoPin(gate - 1) == -1) {
+          fprintf(stderr, "bad --jam %s\n", argv[i]);
+          return 2;
+        }
+        SimShop::jamServo(GateConfig::servoPin(gate - 1), at);
+      } else if (arg == "--eeprom" && i + 1 < argc) {
+        eepromFile = argv[++i];
+      } else if (arg == "--serial-out" && i + 1 < argc) {
+        SimShop::serialCapture = fopen(argv[++i], "wb");
+        if (!SimShop::serialCapture) { fprintf(stderr, "can't write %s\n", argv[i]); return 2; }
+      } else if (arg == "--i2c-log" && i + 1 < argc) {
+        i2cFile = argv[++i];
+      } else if (arg == "--verbose") {
+        SimShop::echoSerial = true;
+      } else {
+        fprintf(stderr, "unknown option %s\n", arg.c_str());
+        return 2;
+      }
+    }
+
+    if (tools.empty() && presses.empty()) {
+      ToolRun saw = { 0, 5000, 15000 };
+      ToolRun sander = { 2, 10000, 25000 };
+      tools.push_back(saw);
+      tools.push_back(sander);
+      Press press = { 35000, 100, 0 };
+      presses.push_back(press);
+    }
+
+    if (eepromFile) SimShop::loadEeprom(eepromFile);
+    else memset(SimShop::eeprom, 0xff, sizeof(SimShop::eeprom));
+    SimShop::mainsHz = MAINS_HZ;
+    SimShop::servoCurrentPin = SERVO_CURRENT_PIN;
+    SimShop::pca9685Boards = SERVO_BACKEND == SERVO_BACKEND_PCA9685 ? PCA9685_BOARDS : 0;
+    SimShop::pca9685Address = PCA9685_ADDRESS;
+    SimShop::pca9685OscHz = PCA9685_OSC_HZ;
+    for (size_t i = 0; i < tools.size(); i++)
+      if (GateConfig::sensorPin(tools[i].sensor) != -1) SimShop::addTool(GateConfig::sensorPin(tools[i].sensor), tools[i].on, tools[i].off);
+    for (size_t i = 0; i < presses.size(); i++)
+      SimShop::pressButton(BUTTON_PIN, presses[i].at, presses[i].length, presses[i].bounces);
+    SimShop::reset();
+
+    // Run the firmware, timing each loop() on the host
+    typedef std::chrono::steady_clock host;
+    host::time_point started = host::now();
+    setup();
+    unsigned long long readyUs = SimShop::clock;
+
+    unsigned long passes = 0;
+    double loopTotal = 0, loopMax = 0;
+    while (SimShop::clock < runMs * 1000ULL) {
+      host::time_point before = host::now();
+      unsigned long long simBefore = SimShop::clock;
+      loop();
+      if (SimShop::clock == simBefore) SimShop::advance(SimShop::callCost);  // a pass that never reads the clock still takes time
+      double cost = std::chrono::duration<double, std::micro>(host::now() - before).count();
+      loopTotal += cost;
+      if (cost > loopMax) loopMax = cost;
+      passes++;
+    }
+    double wallMs = std::chrono::duration<double, std::milli>(host::now() - started).count();
+
+    if (eepromFile) SimShop::saveEeprom(eepromFile);
+    if (SimShop::serialCapture) fclose(SimShop::serialCapture);
+    if (i2cFile && !saveI2cLog(i2cFile)) fprintf(stderr, "can't write %s\n", i2cFile);
+
+    printf("Simulated %.1f s in %.1f ms of host time (%.0fx real time)\n", runMs / 1000.0, wallMs, runMs / (wallMs > 0 ? wallMs : 1));
+    printf("setup() finished at %llu ms\n", readyUs / 1000);
+    printf("%lu loop() passes, host cost per pass avg %.1f us, max %.1f us\n", passes, passes ? loopTotal / passes : 0, loopMax);
+    printf("EEPROM bytes written: %lu\n", SimShop::eepromWrites);
+    if (!SimShop::i2cLog.empty()) {
+      unsigned long bytes = 0, nacks = 0;
+      for (size_t i = 0; i < SimShop::i2cLog.size(); i++) {
+        bytes += SimShop::i2cLog[i].data.size();
+        if (!SimShop::i2cLog[i].acked) nacks++;
+      }
+      printf("I2C transactions: %lu, %lu bytes, %lu not answered\n", (unsigned long)SimShop::i2cLog.size(), bytes, nacks);
+    }
+    printf("Gate response:\n");
+    for (size_t i = 0; i < tools.size(); i++) {
+      reportLatency("on", tools[i].sensor, tools[i].on);
+      reportLatency("off", tools[i].sensor, tools[i].off);
+    }
+    return 0;
+  }
@@ -0,0 +1,603 @@
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include "Arduino.h"
+#include "Servo.h"
+#include "EEPROM.h"
+#include "Wire.h"
+#include "SimShop.h"
+
+  unsigned long long SimShop::clock = 0;
+  unsigned long SimShop::callCost = 2;
+  int SimShop::mainsHz = 60;
+  float SimShop::servoSlewRate = 250;
+  int SimShop::servoCurrentPin = -1;
+  float SimShop::servoIdleCurrent = 20;
+  float SimShop::servoHoldingCurrent = 5;
+  float SimShop::servoMovingCurrent = 120;
+  int SimShop::pca9685Boards = 0;
+  int SimShop::pca9685Address = 0x40;
+  long SimShop::pca9685OscHz = 25000000;
+  bool SimShop::echoSerial = false;
+  FILE *SimShop::serialCapture = NULL;
+  SimShop::Sensor SimShop::sensors[SimShop::num_pins];
+  std::vector<SimShop::Event> SimShop::events;
+  uint8_t SimShop::eeprom[SimShop::eeprom_size];
+  unsigned long SimShop::eepromWrites = 0;
+  std::vector<SimShop::I2cTransaction> SimShop::i2cLog;
+
+  HardwareSerial Serial;
+  EEPROMClass EEPROM;
+  TwoWire Wire;
+
+  // Internal device state
+  struct SimTimer { void (*tick)(); unsigned long long period; unsigned long long next; };
+  static std::vector<SimTimer> timers;
+
+  struct SimPin { int mode = INPUT; int value = LOW; void (*onChange)() = nullptr; };
+  static SimPin pins[SimShop::num_pins];
+  static unsigned long long pinChangesTo = 0;   // pin change interrupts have run for edges up to this time
+  static bool inInterrupt = false;              // clock reads inside a handler take no simulated time
+
+  struct SimPress { int pin; unsigned long long down; unsigned long long up; int bounces; };
+  static std::vector<SimPress> presses;
+
+  // Contact bounce: each of a press's bounces opens the contacts for 200us, one every 500us after the edge
+  static const unsigned long long bounce_gap = 500, bounce_open = 200;
+
+  static bool pressedAt(const SimPress &p, unsigned long long time)
+  {
+    if (time < p.down || time >= p.up) return false;
+    for (int b = 1; b <= p.bounces; b++) {
+      unsigned long long at = p.down + b * bounce_gap;
+      if (time >= at && time < at + bounce_open) return false;
+      at = p.up - b * bounce_gap;
+      if (time >= at && time < at + bounce_open) return false;
+    }
+    return true;
+  }
+
+  // Time of the press's first level change after the given time, or 0 if there are none
+  static unsigned long long nextChange(const SimPress &p, unsigned long long after)
+  {
+    unsigned long long best = 0;
+    for (int b = 0; b <= p.bounces; b++) {
+      // b = 0 is the press and release themselves, after that each bounce opens and recloses the contacts
+      unsigned long long times[4] = { p.down + b * bounce_gap, p.down + b * bounce_gap + bounce_open,
+                                      p.up - b * bounce_gap, p.up - b * bounce_gap + bounce_open };
+      for (int t = 0; t < 4; t++) {
+        if (b == 0 && (t & 1)) continue;
+        if (times[t] > after && (!best || times[t] < best)) best = times[t];
+      }
+    }
+    return best;
+  }
+
+  // Earliest button edge on a pin with a pin change interrupt, or 0 if there are none
+  static unsigned long long nextPinChange(int &pin)
+  {
+    unsigned long long best = 0;
+    for (size_t i = 0; i < presses.size(); i++) {
+      if (presses[i].pin < 0 || presses[i].pin >= SimShop::num_pins || !pins[presses[i].pin].onChange) continue;
+      unsigned long long at = nextChange(presses[i], pinChangesTo);
+      if (at && (!best || at < best)) { best = at; pin = presses[i].pin; }
+    }
+    return best;
+  }
+
+  struct SimServo { bool attached = false; float angle = 90; float target = 90; unsigned long long since = 0; bool arrived = true; };
+  static SimServo servos[SimShop::num_servos];
+  static bool servoJams[SimShop::num_servos];
+  static unsigned long long servoJamAt[SimShop::num_servos];  // us, when servoJams is set
+
+  // PCA9685: the register file, and the pulse in us each channel is sending (-1 while it is off)
+  struct SimPca9685 { uint8_t reg[256]; int pulse[16]; };
+  static std::vector<SimPca9685> pcaBoards;
+  static const uint8_t pca_mode1 = 0x00, pca_led0 = 0x06, pca_all_led = 0xfa, pca_prescale = 0xfe;
+  static const uint8_t pca_restart = 0x80, pca_auto_increment = 0x20, pca_sleep = 0x10, pca_full = 0x10;
+
+  struct SimInput { unsigned long long at; std::string text; };
+  static std::vector<SimInput> serialQueue;
+  static size_t serialPos = 0;
+
+  static unsigned long noiseSeed = 12345;
+
+  // Small deterministic generator so runs are repeatable, returns -1..1
+  static float noise()
+  {
+    noiseSeed = noiseSeed * 1103515245UL + 12345UL;
+    return ((noiseSeed >> 16) & 0x7fff) / 16383.5f - 1.0f;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // reset()
+  //
+  // Power on the shop: clock back to zero, no timers, idle pins and
+  // servos. Tool schedules, button presses and the EEPROM image are kept.
+  //////////////////////////////////////////////////////////////////////
+  void SimShop::reset()
+  {
+    clock = 0;
+    pinChangesTo = 0;
+    timers.clear();
+    events.clear();
+    for (int i = 0; i < num_pins; i++) pins[i] = SimPin();
+    for (int i = 0; i < num_servos; i++) servos[i] = SimServo();
+    serialPos = 0;
+
+    // PCA9685 power on state: asleep, every output off, prescaler for 200 Hz
+    i2cLog.clear();
+    pcaBoards.assign(pca9685Boards, SimPca9685());
+    for (size_t b = 0; b < pcaBoards.size(); b++) {
+      memset(pcaBoards[b].reg, 0, sizeof(pcaBoards[b].reg));
+      pcaBoards[b].reg[pca_mode1] = pca_sleep | 0x01;
+      pcaBoards[b].reg[0x01] = 0x04;
+      for (int ch = 0; ch < 16; ch++) {
+        pcaBoards[b].reg[pca_led0 + 4 * ch + 3] = pca_full;
+        pcaBoards[b].pulse[ch] = -1;
+      }
+      pcaBoards[b].reg[pca_prescale] = 0x1e;
+    }
+  }
+
+  // Bring a servo's modelled angle up to the given time
+  static void updateServo(int pin, unsigned long long time)
+  {
+    SimServo &s = servos[pin];
+    if (!s.attached || s.arrived) { s.since = time; return; }
+    if (servoJams[pin] && time >= servoJamAt[pin]) { s.since = time; return; }  // stalled, still drawing current
+
+    float step = SimShop::servoSlewRate * (time - s.since) / 1000000.0f;
+    float remaining = fabsf(s.target - s.angle);
+    if (step >= remaining) {
+      unsigned long long arrival = s.since + (unsigned long long)(remaining / SimShop::servoSlewRate * 1000000.0f);
+      s.angle = s.target;
+      s.arrived = true;
+      SimShop::log(SimShop::EV_SERVO_ARRIVED, pin, (int)s.angle, arrival);
+    } else {
+      s.angle += s.target > s.angle ? step : -step;
+    }
+    s.since = time;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // advance(unsigned long long us)
+  //
+  // Move the clock forward, running each timer tick and pin change
+  // interrupt at its own time so the sampler sees the signal exactly as
+  // the real ADC would and button edges are stamped when they happen
+  //////////////////////////////////////////////////////////////////////
+  void SimShop::advance(unsigned long long us)
+  {
+    if (inInterrupt) return;
+    unsigned long long target = clock + us;
+    for (;;) {
+      SimTimer *due = nullptr;
+      for (size_t i = 0; i < timers.size(); i++)
+        if (timers[i].next <= target && (!due || timers[i].next < due->next)) due = &timers[i];
+
+      int pin = -1;
+      unsigned long long change = nextPinChange(pin);
+      if (change && change <= target && (!due || change < due->next)) {
+        clock = change;
+        pinChangesTo = change;
+        inInterrupt = true;
+        pins[pin].onChange();
+        inInterrupt = false;
+        continue;
+      }
+      if (!due) break;
+
+      clock = due->next;
+      due->next += due->period;
+      inInterrupt = true;
+      due->tick();
+      inInterrupt = false;
+    }
+    clock = target;
+    for (int servo = 0; servo < num_servos; servo++) updateServo(servo, clock);
+  }
+
+  void SimShop::startTimer(long hz, void (*tick)())
+  {
+    stopTimer(tick);
+    SimTimer timer;
+    timer.tick = tick;
+    timer.period = 1000000ULL / hz;
+    timer.next = clock + timer.period;
+    timers.push_back(timer);
+  }
+
+  void SimShop::stopTimer(void (*tick)())
+  {
+    for (size_t i = 0; i < timers.size(); i++)
+      if (timers[i].tick == tick) { timers.erase(timers.begin() + i); return; }
+  }
+
+  void SimShop::attachPinChange(int pin, void (*isr)())
+  {
+    if (pin < 0 || pin >= num_pins) return;
+    pins[pin].onChange = isr;
+    pinChangesTo = clock;
+  }
+
+  void SimShop::addTool(int pin, unsigned long onMs, unsigned long offMs)
+  {
+    sensors[pin].onAt.push_back(onMs * 1000ULL);
+    sensors[pin].offAt.push_back(offMs * 1000ULL);
+  }
+
+  void SimShop::pressButton(int pin, unsigned long atMs, unsigned long forMs, int bounces)
+  {
+    SimPress press = { pin, atMs * 1000ULL, (atMs + forMs) * 1000ULL, bounces };
+    presses.push_back(press);
+  }
+
+  void SimShop::serialInput(unsigned long atMs, const char *text)
+  {
+    SimInput input = { atMs * 1000ULL, text };
+    serialQueue.push_back(input);
+  }
+
+  bool SimShop::loadEeprom(const char *path)
+  {
+    memset(eeprom, 0xff, sizeof(eeprom));  // blank EEPROM reads as 0xff
+    FILE *f = fopen(path, "rb");
+    if (!f) return false;
+    size_t n = fread(eeprom, 1, sizeof(eeprom), f);
+    fclose(f);
+    return n == sizeof(eeprom);
+  }
+
+  bool SimShop::saveEeprom(const char *path)
+  {
+    FILE *f = fopen(path, "wb");
+    if (!f) return false;
+    size_t n = fwrite(eeprom, 1, sizeof(eeprom), f);
+    fclose(f);
+    return n == sizeof(eeprom);
+  }
+
+  void SimShop::log(EventType type, int pin, int value, unsigned long long time)
+  {
+    Event event = { time, type, pin, value };
+    events.push_back(event);
+  }
+
+  int SimShop::readAnalog(int pin)
+  {
+    if (pin < 0 || pin >= num_pins) return 0;
+    if (pin == servoCurrentPin) {
+      float current = servoIdleCurrent + 2 * noise();
+      for (int i = 0; i < num_servos; i++) {
+        updateServo(i, clock);
+        if (servos[i].attached) current += servos[i].arrived ? servoHoldingCurrent : servoMovingCurrent;
+      }
+      return (int)current;
+    }
+    Sensor &s = sensors[pin];
+    if (s.source) return s.source(pin, clock);
+
+    bool on = false;
+    for (size_t i = 0; i < s.onAt.size(); i++)
+      if (clock >= s.onAt[i] && clock < s.offAt[i]) on = true;
+
+    float value = s.offLevel + s.noise * noise();
+    if (on) value += s.amplitude * fabsf(sinf(2.0f * (float)PI * mainsHz * clock / 1000000.0f));
+    if (value < 0) value = 0;
+    if (value > 1023) value = 1023;
+    return (int)value;
+  }
+
+  int SimShop::readDigital(int pin)
+  {
+    if (pin < 0 || pin >= num_pins) return LOW;
+    if (pins[pin].mode == OUTPUT) return pins[pin].value;
+    for (size_t i = 0; i < presses.size(); i++)
+      if (presses[i].pin == pin && pressedAt(presses[i], clock)) return LOW;
+    return pins[pin].mode == INPUT_PULLUP ? HIGH : LOW;
+  }
+
+  void SimShop::writeDigital(int pin, int value)
+  {
+    if (pin < 0 || pin >= num_pins) return;
+    if (pins[pin].value != value) log(EV_PIN_WRITE, pin, value, clock);
+    pins[pin].value = value;
+  }
+
+  void SimShop::setPinMode(int pin, int mode)
+  {
+    if (pin < 0 || pin >= num_pins) return;
+    pins[pin].mode = mode;
+  }
+
+  void SimShop::jamServo(int servo, unsigned long atMs)
+  {
+    if (servo < 0 || servo >= num_servos) return;
+    servoJams[servo] = true;
+    servoJamAt[servo] = atMs * 1000ULL;
+  }
+
+  void SimShop::servoAttach(int pin)
+  {
+    if (pin < 0 || pin >= num_servos) return;
+    updateServo(pin, clock);
+    servos[pin].attached = true;
+    servos[pin].since = clock;
+    log(EV_SERVO_ATTACH, pin, 0, clock);
+  }
+
+  void SimShop::servoWrite(int pin, int pulseMicros)
+  {
+    if (pin < 0 || pin >= num_servos) return;
+    updateServo(pin, clock);
+    float angle = (pulseMicros - MIN_PULSE_WIDTH) * 180.0f / (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH);
+    SimServo &s = servos[pin];
+    if (fabsf(angle - s.target) > 0.01f || !s.arrived) {
+      s.target = angle;
+      s.arrived = fabsf(s.angle - angle) < 0.01f;
+    }
+    log(EV_SERVO_WRITE, pin, (int)(angle + 0.5f), clock);
+  }
+
+  void SimShop::servoDetach(int pin)
+  {
+    if (pin < 0 || pin >= num_servos) return;
+    updateServo(pin, clock);
+    servos[pin].attached = false;  // unpowered, it stops where it is
+    log(EV_SERVO_DETACH, pin, (int)servos[pin].angle, clock);
+  }
+
+  // Follow a board's outputs with the servos on its channels
+  static void updatePcaOutputs(int board)
+  {
+    SimPca9685 &chip = pcaBoards[board];
+    bool asleep = chip.reg[pca_mode1] & pca_sleep;
+    for (int ch = 0; ch < 16; ch++) {
+      const uint8_t *led = &chip.reg[pca_led0 + 4 * ch];
+      int on = led[0] | (led[1] & 0x0f) << 8;
+      int off = led[2] | (led[3] & 0x0f) << 8;
+      int pulse = -1;
+      if (!asleep && !(led[1] & pca_full) && !(led[3] & pca_full))
+        pulse = (int)(((off - on) & 0xfff) * (chip.reg[pca_prescale] + 1) * 1000000.0 / SimShop::pca9685OscHz + 0.5);
+      if (pulse == chip.pulse[ch]) continue;
+
+      int servo = board * 16 + ch;
+      if (pulse == -1) SimShop::servoDetach(servo);
+      else {
+        if (chip.pulse[ch] == -1) SimShop::servoAttach(servo);
+        SimShop::servoWrite(servo, pulse);
+      }
+      chip.pulse[ch] = pulse;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // i2cWrite(uint8_t address, const uint8_t *data, int length)
+  //
+  // Log a write transaction and hand it to the device at that address.
+  // A PCA9685 takes the first byte as the register to start at and, with
+  // auto-increment on, moves to the next register after each byte. The
+  // prescaler only takes a write while the board is asleep, as on the chip.
+  //////////////////////////////////////////////////////////////////////
+  bool SimShop::i2cWrite(uint8_t address, const uint8_t *data, int length)
+  {
+    I2cTransaction transaction = { clock, address, std::vector<uint8_t>(data, data + length), false };
+    int board = address - pca9685Address;
+    if (board >= 0 && board < (int)pcaBoards.size()) {
+      transaction.acked = true;
+      SimPca9685 &chip = pcaBoards[board];
+      uint8_t reg = length > 0 ? data[0] : 0;
+      for (int i = 1; i < length; i++) {
+        if (reg >= pca_all_led && reg < pca_prescale) {
+          for (int ch = 0; ch < 16; ch++) chip.reg[pca_led0 + 4 * ch + reg - pca_all_led] = data[i];
+        } else if (reg == pca_mode1) {
+          chip.reg[reg] = data[i] & ~pca_restart;
+        } else if (reg != pca_prescale || (chip.reg[pca_mode1] & pca_sleep)) {
+          chip.reg[reg] = data[i];
+        }
+        if (chip.reg[pca_mode1] & pca_auto_increment) reg = reg == 0x45 || reg == 0xfe ? 0 : reg + 1;
+      }
+      updatePcaOutputs(board);
+    }
+    i2cLog.push_back(transaction);
+    return transaction.acked;
+  }
+
+  int SimShop::serialAvailable()
+  {
+    int count = 0;
+    for (size_t i = 0; i < serialQueue.size(); i++) {
+      if (serialQueue[i].at > clock) break;
+      count += serialQueue[i].text.size();
+    }
+    return count - (int)serialPos;
+  }
+
+  int SimShop::serialRead()
+  {
+    if (serialAvailable() <= 0) return -1;
+    size_t pos = serialPos++;
+    for (size_t i = 0; i < serialQueue.size(); i++) {
+      if (pos < serialQueue[i].text.size()) return (uint8_t)serialQueue[i].text[pos];
+      pos -= serialQueue[i].text.size();
+    }
+    return -1;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Arduino core functions
+  //
+  // Reading the clock costs callCost microseconds so polling loops that
+  // wait on millis() still move simulated time forward
+  //////////////////////////////////////////////////////////////////////
+  unsigned long millis()
+  {
+    SimShop::advance(SimShop::callCost);
+    return (unsigned long)(SimShop::clock / 1000ULL);
+  }
+
+  unsigned long micros()
+  {
+    SimShop::advance(SimShop::callCost);
+    return (unsigned long)SimShop::clock;
+  }
+
+  void delay(unsigned long ms) { SimShop::advance(ms * 1000ULL); }
+  void delayMicroseconds(unsigned int us) { SimShop::advance(us); }
+  void pinMode(uint8_t pin, uint8_t mode) { SimShop::setPinMode(pin, mode); }
+  void digitalWrite(uint8_t pin, uint8_t val) { SimShop::writeDigital(pin, val); }
+  int digitalRead(uint8_t pin) { return SimShop::readDigital(pin); }
+  int analogRead(uint8_t pin) { return SimShop::readAnalog(pin >= A0 ? pin : pin + A0); }
+  void noInterrupts() {}
+  void interrupts() {}
+
+  //////////////////////////////////////////////////////////////////////
+  // Print, formatted the same way as the Arduino core
+  //////////////////////////////////////////////////////////////////////
+  size_t Print::write(const uint8_t *buffer, size_t size)
+  {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+  }
+
+  size_t Print::printNumber(unsigned long n, int base)
+  {
+    char buf[8 * sizeof(long) + 1];
+    char *str = &buf[sizeof(buf) - 1];
+    *str = '\0';
+    if (base < 2) base = 10;
+    do {
+      char c = n % base;
+      n /= base;
+      *--str = c < 10 ? c + '0' : c + 'A' - 10;
+    } while (n);
+    return write(str);
+  }
+
+  size_t Print::printFloat(double number, int digits)
+  {
+    char buf[48];
+    snprintf(buf, sizeof(buf), "%.*f", digits, number);
+    return write(buf);
+  }
+
+  size_t Print::print(const __FlashStringHelper *str) { return write(reinterpret_cast<const char *>(str)); }
+  size_t Print::print(const char *str) { return write(str); }
+  size_t Print::print(char c) { return write((uint8_t)c); }
+  size_t Print::print(unsigned char n, int base) { return printNumber(n, base); }
+  size_t Print::print(unsigned int n, int base) { return printNumber(n, base); }
+  size_t Print::print(unsigned long n, int base) { return printNumber(n, base); }
+  size_t Print::print(int n, int base) { return print((long)n, base); }
+  size_t Print::print(long n, int base)
+  {
+    if (base == 10 && n < 0) return write('-') + printNumber(-n, 10);
+    return printNumber(n, base);
+  }
+  size_t Print::print(double n, int digits) { return printFloat(n, digits); }
+  size_t Print::println() { return write("\r\n"); }
+
+  // Transmit timing: bytes leave at the baud rate and write() blocks once the
+  // 64 byte buffer is full, like the Arduino core
+  static const int serial_buffer = 64;
+  static unsigned long long serialByteUs = 0;
+  static unsigned long long serialDoneAt = 0;
+
+  void HardwareSerial::begin(unsigned long baud) { serialByteUs = baud ? 10000000ULL / baud : 0; serialDoneAt = 0; }
+  int HardwareSerial::available() { return SimShop::serialAvailable(); }
+  int HardwareSerial::read() { return SimShop::serialRead(); }
+  int HardwareSerial::availableForWrite()
+  {
+    if (!serialByteUs || serialDoneAt <= SimShop::clock) return serial_buffer - 1;
+    long queued = (long)((serialDoneAt - SimShop::clock + serialByteUs - 1) / serialByteUs);
+    return queued < serial_buffer - 1 ? serial_buffer - 1 - queued : 0;
+  }
+
+  size_t HardwareSerial::write(uint8_t c)
+  {
+    if (SimShop::echoSerial && c != '\r') putchar(c);
+    if (SimShop::serialCapture) fputc(c, SimShop::serialCapture);
+    if (serialByteUs) {
+      if (serialDoneAt < SimShop::clock) serialDoneAt = SimShop::clock;
+      serialDoneAt += serialByteUs;
+      unsigned long long queued = serialDoneAt - SimShop::clock;
+      if (queued > serial_buffer * serialByteUs) SimShop::advance(queued - serial_buffer * serialByteUs);
+    }
+    return 1;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Wire library
+  //////////////////////////////////////////////////////////////////////
+  void TwoWire::beginTransmission(uint8_t newaddress)
+  {
+    address = newaddress;
+    length = 0;
+  }
+
+  size_t TwoWire::write(uint8_t value)
+  {
+    if (length >= BUFFER_LENGTH) return 0;
+    buffer[length++] = value;
+    return 1;
+  }
+
+  size_t TwoWire::write(const uint8_t *data, size_t count)
+  {
+    for (size_t i = 0; i < count; i++)
+      if (!write(data[i])) return i;
+    return count;
+  }
+
+  // Start, the address and data bytes with their acknowledge bits, and stop
+  uint8_t TwoWire::endTransmission(bool sendStop)
+  {
+    (void)sendStop;
+    SimShop::advance((unsigned long long)(9 * (length + 1) + 2) * 1000000ULL / clockHz);
+    bool acked = SimShop::i2cWrite(address, buffer, length);
+    length = 0;
+    return acked ? 0 : 2;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Servo library
+  //////////////////////////////////////////////////////////////////////
+  uint8_t Servo::attach(int newpin)
+  {
+    if (pin != -1) detach();
+    pin = newpin;
+    SimShop::servoAttach(pin);
+    SimShop::servoWrite(pin, pulse);
+    return 0;
+  }
+
+  void Servo::detach()
+  {
+    if (pin == -1) return;
+    SimShop::servoDetach(pin);
+    pin = -1;
+  }
+
+  void Servo::write(int value)
+  {
+    if (value < MIN_PULSE_WIDTH) {
+      if (value < 0) value = 0;
+      if (value > 180) value = 180;
+      value = MIN_PULSE_WIDTH + (long)value * (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH) / 180;
+    }
+    writeMicroseconds(value);
+  }
+
+  void Servo::writeMicroseconds(int value)
+  {
+    if (value < MIN_PULSE_WIDTH) value = MIN_PULSE_WIDTH;
+    if (value > MAX_PULSE_WIDTH) value = MAX_PULSE_WIDTH;
+    pulse = value;
+    if (pin != -1) SimShop::servoWrite(pin, pulse);
+  }
+
+  int Servo::read()
+  {
+    return (pulse - MIN_PULSE_WIDTH) * 180L / (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH);
+  }
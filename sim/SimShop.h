@@ -0,0 +1,93 @@
+/*
+  SimShop.h - Simulated shop for the native build: a virtual clock, AC current
+  sensors on the analog pins, servos, a push button, EEPROM and PCA9685 servo
+  boards on the I2C bus
+  Released into the public domain.
+*/
+#ifndef SimShop_h
+#define SimShop_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+  class SimShop {
+    public:
+      // Everything the firmware did that a scenario might want to check
+      enum EventType { EV_TOOL_ON, EV_TOOL_OFF, EV_BUTTON_DOWN, EV_BUTTON_UP, EV_PIN_WRITE,
+                       EV_SERVO_ATTACH, EV_SERVO_WRITE, EV_SERVO_ARRIVED, EV_SERVO_DETACH };
+      struct Event {
+        unsigned long long time;   // microseconds of simulated time
+        EventType type;
+        int pin;
+        int value;
+      };
+
+      // Current sensor model: off level plus a full wave rectified mains signal while the tool runs
+      struct Sensor {
+        float offLevel = 30;       // ADC counts with the tool off
+        float noise = 3;           // uniform noise, +/- ADC counts
+        float amplitude = 250;     // peak of the rectified mains signal with the tool on
+        std::vector<unsigned long long> onAt;   // tool switch on times (us)
+        std::vector<unsigned long long> offAt;  // matching switch off times (us)
+        int (*source)(int pin, unsigned long long time) = nullptr;  // optional override, e.g. a recorded trace
+      };
+
+      // Every I2C write the firmware made, whether or not a device answered
+      struct I2cTransaction {
+        unsigned long long time;   // microseconds of simulated time when the stop was sent
+        uint8_t address;
+        std::vector<uint8_t> data;
+        bool acked;
+      };
+
+      static const int num_pins = 20;
+      static const int num_servos = 64;      // servo numbers: the pin, or the PCA9685 channel counted across boards
+      static const int eeprom_size = 1024;
+
+      static unsigned long long clock;       // simulated microseconds since power on
+      static unsigned long callCost;         // simulated microseconds consumed by each millis()/micros() call
+      static int mainsHz;
+      static float servoSlewRate;            // degrees per second while a servo is attached
+      static int servoCurrentPin;            // analog pin reading the servo supply current, -1 for none
+      static float servoIdleCurrent;         // ADC counts on servoCurrentPin with every servo detached
+      static float servoHoldingCurrent;      // added for each attached servo holding its position
+      static float servoMovingCurrent;       // added for each attached servo that is moving
+      static int pca9685Boards;              // PCA9685 boards on the I2C bus, 0 for none
+      static int pca9685Address;             // address of the first, the rest follow it
+      static long pca9685OscHz;              // their oscillator
+      static bool echoSerial;                // copy firmware serial output to stdout
+      static FILE *serialCapture;            // if set, every byte the firmware sends is written here
+      static Sensor sensors[num_pins];       // indexed by analog pin number (A0 = 14)
+      static std::vector<Event> events;
+      static uint8_t eeprom[eeprom_size];
+      static unsigned long eepromWrites;
+      static std::vector<I2cTransaction> i2cLog;
+
+      static void reset();                                       // power on: clock to zero, devices idle
+      static void advance(unsigned long long us);                // run time forward, firing timers on the way
+      static void startTimer(long hz, void (*tick)());           // periodic interrupt (replaces Timer2)
+      static void stopTimer(void (*tick)());
+      static void attachPinChange(int pin, void (*isr)());      // interrupt on each level change of a button pin
+      static void addTool(int pin, unsigned long onMs, unsigned long offMs); // tool on the given sensor pin runs between these times
+      static void pressButton(int pin, unsigned long atMs, unsigned long forMs, int bounces = 0);
+      static void serialInput(unsigned long atMs, const char *text); // bytes arriving on the serial port
+      static void jamServo(int servo, unsigned long atMs);     // from then on the servo stops where it is, straining against any other target
+      static bool loadEeprom(const char *path);
+      static bool saveEeprom(const char *path);
+
+      // Used by the Arduino stand-ins
+      static int readAnalog(int pin);
+      static int readDigital(int pin);
+      static void writeDigital(int pin, int value);
+      static void setPinMode(int pin, int mode);
+      static void servoAttach(int pin);
+      static void servoWrite(int pin, int pulseMicros);
+      static void servoDetach(int pin);
+      static bool i2cWrite(uint8_t address, const uint8_t *data, int length);  // false if no device answered
+      static int serialRead();
+      static int serialAvailable();
+      static void log(EventType type, int pin, int value, unsigned long long time);
+  };
+
+#endif
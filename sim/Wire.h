@@ -0,0 +1,31 @@
+/*
+  Wire.h - Host stand-in for the Arduino Wire library, writes go to the simulated I2C devices in SimShop.h
+  Released into the public domain.
+*/
+#ifndef TwoWire_h
+#define TwoWire_h
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32
+
+  class TwoWire {
+    uint8_t address = 0;
+    uint8_t buffer[BUFFER_LENGTH];
+    int length = 0;
+    unsigned long clockHz = 100000;
+
+    public:
+      void begin() {}
+      void setClock(unsigned long hz) { clockHz = hz; }
+      void beginTransmission(uint8_t address);
+      void beginTransmission(int address) { beginTransmission((uint8_t)address); }
+      size_t write(uint8_t value);                      // 0 once the 32 byte buffer is full, like the AVR library
+      size_t write(int value) { return write((uint8_t)value); }
+      size_t write(const uint8_t *data, size_t count);
+      uint8_t endTransmission(bool sendStop = true);    // takes the bus time, 0 = sent, 2 = no device answered
+  };
+
+  extern TwoWire Wire;
+
+#endif
@@ -2,12 +2,28 @@
 #include "Debug.h"
 #include "Configuration.h"
 #include "AcSensors.h"
+#include "AdcSampler.h"
+#include "LatencyStats.h"
+#include "Telemetry.h"
 
 const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
 
   AcSensors::AcSensors()
   {
-    DPRINTLN("AC Sensors object created");
+    // Running totals rely on the window starting out empty
+    for (int x = 0; x < ac_sensors; x++) {
+      cycleWindow[x].count = 0;
+      cycleWindow[x].bias = -1;
+      amplitudeQ4[x] = 0;
+      offReadings[x] = 0;
+      readingTotals[x] = 0;
+      recentReadings[x].clear();
+      passTotal[x] = 0;
+      passCount[x] = 0;
+      passAbove[x] = false;
+    }
+    updateThresholds();
+    DPRINTLN(F("AC Sensors object created"));
   }
   
   float AcSensors::GetOffReading(int sensor) {
@@ -17,10 +33,61 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
       return 0;
   }
   
+  float AcSensors::GetOffMean(int sensor) {
+      return offMean[sensor];
+  }
+
+  float AcSensors::GetOffVariance(int sensor) {
+      return offVariance[sensor];
+  }
+
   float AcSensors::GetAvgReading(int sensor) {
-      return AvgSensorReading(sensor);
+      return DetectorReading(sensor);
+  }
+
+  float AcSensors::DetectorReading(int sensor) {
+      return (float)detectorValue(sensor) / detectorScale();
+  }
+
+  long AcSensors::detectorValue(int sensor) {
+      #if DETECTION_MODE == DETECT_MEAN
+      return readingTotals[sensor];
+      #else
+      return amplitudeQ4[sensor];
+      #endif
+  }
+
+  long AcSensors::detectorScale() {
+      #if DETECTION_MODE == DETECT_MEAN
+      return avgWindow;
+      #else
+      return 1 << amplitude_shift;
+      #endif
   }
   
+  //////////////////////////////////////////////////////////////////////
+  // SetTuning(float on, float off, int debounce, int window)
+  //
+  // Replace the AC_SENSOR_SENSITIVITY_ON/OFF, DEBOUNCE_STABLE_READINGS and
+  // AVG_READINGS values, used by the replay tools to try other settings.
+  // The window can't be larger than AVG_READINGS. Clears the average.
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::SetTuning(float on, float off, int debounce, int window)
+  {
+    sensitivityOnQ8 = (int)(on * (1 << sensitivity_shift) + 0.5);
+    sensitivityOffQ8 = (int)(off * (1 << sensitivity_shift) + 0.5);
+    debounceStableReadings = debounce;
+    avgWindow = window < 1 ? 1 : (window > avg_readings ? avg_readings : window);
+    updateThresholds();
+
+    curreadingindex = 0;
+    for (int x = 0; x < ac_sensors; x++) {
+      readingTotals[x] = 0;
+      recentReadings[x].clear();
+    }
+  }
+
   //////////////////////////////////////////////////////////////////////
   // InitializeSensors()
   //
@@ -29,19 +96,66 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
   //////////////////////////////////////////////////////////////////////
   void AcSensors::InitializeSensors()
   {
-      DPRINTLN("Initializing AC sensors...");
-      DPRINT("Number of sensors: "); DPRINTLN(num_ac_sensors);
+      startSampling();
+
+      DPRINTLN(F("Getting baseline sensor readings..."));
+      getMaxOffSensorReadings();
+      IPRINTLN(F("AC sensor initialization complete"));
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // InitializeSensors(const float *savedOffReadings)
+  //
+  // Warm boot: start with baselines saved by a previous run so the
+  // sensors are usable immediately. Fresh baselines are taken in the
+  // background by ReadSensors() once every tool has been off for
+  // RECALIBRATE_QUIET_MS.
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::InitializeSensors(const float *savedOffReadings)
+  {
+      startSampling();
+
+      for (int x = 0; x < num_ac_sensors && x < NUM_AC_SENSORS; x++) {
+          offReadings[x] = savedOffReadings[x];
+          TLOG(Telemetry::TM_BASELINE, x, (int16_t)(offReadings[x] * 10));
+          IPRINT(F("SAVED OFF READING: "));
+          IPRINTLN(offReadings[x]);
+      }
+      updateThresholds();
+      baselinesValid = true;
+      recalibrationPending = true;
+      quietSince = millis();
+      IPRINTLN(F("AC sensor initialization complete, recalibrating in background"));
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // startSampling()
+  //
+  // Set up the LED pins and start the background sampler
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::startSampling()
+  {
+      DPRINTLN(F("Initializing AC sensors..."));
+      DPRINT(F("Number of sensors: ")); DPRINTLN(num_ac_sensors);
       
       for (int x = 0; x < num_ac_sensors && x < NUM_AC_SENSORS; x++) {
-          DPRINT("Setting up LED pin "); DPRINT(ledpin[x]); DPRINTLN(" as OUTPUT");
-          pinMode(ledpin[x], OUTPUT);
+          DPRINT(F("Setting up LED pin ")); DPRINT(GateConfig::ledPin(x)); DPRINTLN(F(" as OUTPUT"));
+          pinMode(GateConfig::ledPin(x), OUTPUT);
       }
       
-      DPRINTLN("Getting baseline sensor readings...");
-      //getAvgOffSensorReadings();
-  
-      getMaxOffSensorReadings();
-      DPRINTLN("AC sensor initialization complete");
+      //getAvgOffSensorReadings();   // uses analogRead(), so must run before sampling starts
+
+      // From here on the sensors are sampled in the background
+      AdcSampler::begin(num_ac_sensors);
+      DPRINT(F("Sampling each sensor at ")); DPRINT(AdcSampler::channelRate()); DPRINTLN(F(" Hz"));
+
+      // Size the amplitude window to cover whole mains cycles at this sample rate
+      windowSamples = (AdcSampler::channelRate() * DETECT_WINDOW_CYCLES + MAINS_HZ / 2) / MAINS_HZ;
+      if (windowSamples < 2) windowSamples = 2;
+      if (AdcSampler::channelRate() > 0)
+        goertzelCoeff = (int)(2.0 * cos(2.0 * PI * MAINS_HZ / AdcSampler::channelRate()) * 16384.0 + 0.5);
   }
 
 
@@ -49,64 +163,417 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
   // AvgSensorReading(int forsensor)
   //
   // returns an average of the last X sensors readings for given sensor
+  // The total is kept up to date by ReadSensors() so this is O(1)
   //
   //////////////////////////////////////////////////////////////////////
   float AcSensors::AvgSensorReading(int forsensor)
   {
-    int res = 0;
-    for (int x = 0; x < avg_readings; x++)
-    {
-      res = res + recentReadings[forsensor][x];
-    }
-    return (float)res / (float)avg_readings;
+    return (float)readingTotals[forsensor] / (float)avgWindow;
   }
 
   //////////////////////////////////////////////////////////////////////
   // getMaxOffSensorReadings()
   //
-  // Poll for NUM_OFF_MAX_SAMPLES ms to determine maximum 'off' sensor
-  // reading for this sensor
+  // Poll the background sampler for NUM_OFF_MAX_SAMPLES ms to determine
+  // the 'off' baseline of every sensor. All sensors are calibrated in the
+  // same window, so calibration time doesn't grow with the sensor count.
   //
   //////////////////////////////////////////////////////////////////////
   void AcSensors::getMaxOffSensorReadings()
+  {
+    baselinesValid = false;   // no state changes until there is a baseline to compare with
+    beginCalibration();
+
+    // Round-robin over the sensors, draining whatever the sampler has collected for each
+    while (calibrating)
+    {
+      for (int x = 0; x < num_ac_sensors && x < NUM_AC_SENSORS; x++)
+      {
+        while (AdcSampler::available(x) > 0) processSample(x, AdcSampler::read(x));
+      }
+      if (millis() - calibrationStart >= (unsigned long)numoffmaxsamples) finishCalibration();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // beginCalibration()
+  //
+  // Reset the baseline statistics, samples are added by processSample()
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::beginCalibration()
   {
     for (int x = 0; x < num_ac_sensors && x < NUM_AC_SENSORS; x++)
     {
-        int maxsensorval = 0;
-        for (long y = 0; y < numoffmaxsamples; y++)
-        {      
-          int sensorval = analogRead(sensorPins[x]);
-          if (sensorval > maxsensorval) maxsensorval = sensorval;
-          delay(1);
+      offStats[x].maxValue = 0;
+      offStats[x].total = 0;
+      offStats[x].squares = 0;
+      offStats[x].count = 0;
+      offStats[x].maxAmplitudeQ4 = (int)(MIN_OFF_AMPLITUDE * (1 << amplitude_shift));
+    }
+    calibrationStart = millis();
+    calibrating = true;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // finishCalibration()
+  //
+  // Turn the gathered max, mean and variance into new baselines. The
+  // cycle based modes use the max window amplitude as the baseline.
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::finishCalibration()
+  {
+    for (int x = 0; x < num_ac_sensors && x < NUM_AC_SENSORS; x++)
+    {
+        OffStats &st = offStats[x];
+        if (st.count > 0) {
+          offMean[x] = (float)st.total / st.count;
+          offVariance[x] = (float)st.squares / st.count - offMean[x] * offMean[x];
+          if (offVariance[x] < 0) offVariance[x] = 0;
+        } else {
+          offMean[x] = 0;
+          offVariance[x] = 0;
         }
-        offReadings[x] = maxsensorval;
-        DPRINT("OFF READING: ");
-        DPRINTLN(offReadings[x]);
+
+        #if DETECTION_MODE == DETECT_MEAN
+        offReadings[x] = st.maxValue;
+        #else
+        offReadings[x] = (float)st.maxAmplitudeQ4 / (1 << amplitude_shift);
+        #endif
+
+        TLOG(Telemetry::TM_BASELINE, x, (int16_t)(offReadings[x] * 10));
+        IPRINT(F("OFF READING: "));
+        IPRINT(offReadings[x]);
+        IPRINT(F(" MAX: ")); IPRINT(st.maxValue);
+        IPRINT(F(" MEAN: ")); IPRINT(offMean[x]);
+        IPRINT(F(" VARIANCE: ")); IPRINTLN(offVariance[x]);
+    }
+
+    updateThresholds();
+
+    calibrating = false;
+    recalibrationPending = false;
+    baselinesValid = true;
+    baselinesChanged = true;
+  }
+
+  // Floor of a Q12 value times scale, without overflowing a long for large scales
+  static long scaleQ12(long value, long scale)
+  {
+    return (value >> 12) * scale + (((value & 0xfff) * scale) >> 12);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // updateThresholds()
+  //
+  // Work out each sensor's on and off thresholds once, from its baseline
+  // and the Q8 sensitivities, so the detection path only compares
+  // integers. In DETECT_MEAN mode the window sum is above its threshold
+  // exactly when the average is above baseline * sensitivity, as the sums
+  // are whole numbers and the thresholds are rounded down.
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::updateThresholds()
+  {
+    long scale = detectorScale();
+    for (int x = 0; x < ac_sensors; x++)
+    {
+      // A Q4 baseline times a Q8 sensitivity is a Q12 threshold
+      long offQ4 = (long)(offReadings[x] * (1 << amplitude_shift) + 0.5);
+      long onQ12 = offQ4 * sensitivityOnQ8;
+      long offQ12 = offQ4 * sensitivityOffQ8;
+      onLimit[x] = scaleQ12(onQ12, scale);
+      offLimit[x] = scaleQ12(offQ12, scale);
+      sampleOnLimit[x] = onQ12 >> 12;
+      offLevel[x] = offQ4 >> amplitude_shift;
+
+      #if ENABLE_FAST_TRIGGER
+      #if DETECTION_MODE == DETECT_MEAN
+      long fastScale = windowSamples;
+      #else
+      long fastScale = 1 << amplitude_shift;
+      #endif
+      fastLimit[x] = scaleQ12(offQ4 * fast_sensitivity_q8, fastScale);
+      fastLow[x] = scaleQ12(onQ12, fastScale);
+      #endif
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // BaselinesChanged()
+  //
+  // Returns true once after new baselines have been calibrated, so the
+  // caller can save them
+  //
+  //////////////////////////////////////////////////////////////////////
+  bool AcSensors::BaselinesChanged()
+  {
+    bool changed = baselinesChanged;
+    baselinesChanged = false;
+    return changed;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // processSample(int sensor, int value)
+  //
+  // Route one raw sample to calibration and the cycle based detectors.
+  // While the sensor is off, returns true if the sample (or the cycle
+  // window it completed) is above the on threshold.
+  //
+  //////////////////////////////////////////////////////////////////////
+  bool AcSensors::processSample(int sensor, int value)
+  {
+    bool watching = baselinesValid && !sensorState[sensor];
+    bool above = false;
+
+    if (calibrating)
+    {
+      OffStats &st = offStats[sensor];
+      if (value > st.maxValue) st.maxValue = value;
+      st.total += value;
+      st.squares += (long)value * value;
+      st.count++;
+    }
+
+    #if DETECTION_MODE != DETECT_MEAN
+    // Each completed mains cycle window is one reading for the debounce logic
+    if (addCycleSample(sensor, value))
+    {
+      if (calibrating && amplitudeQ4[sensor] > offStats[sensor].maxAmplitudeQ4)
+        offStats[sensor].maxAmplitudeQ4 = amplitudeQ4[sensor];
+      if (watching)
+        above = amplitudeQ4[sensor] > onLimit[sensor];
+      if (baselinesValid)
+        updateSensorState(sensor, amplitudeQ4[sensor]);
+      #if ENABLE_FAST_TRIGGER
+      checkFastTrigger(sensor, amplitudeQ4[sensor], watching);
+      #endif
+    }
+    #else
+    if (watching) above = value > sampleOnLimit[sensor];
+    #if ENABLE_FAST_TRIGGER
+    // The fast trigger looks at the mean of whole mains cycles, single samples swing too much
+    fastSum[sensor] += value;
+    if (++fastCount[sensor] >= windowSamples) {
+      checkFastTrigger(sensor, fastSum[sensor], watching);
+      fastSum[sensor] = 0;
+      fastCount[sensor] = 0;
+    }
+    #endif
+    #endif
+
+    return above;
+  }
+
+  #if ENABLE_FAST_TRIGGER
+  //////////////////////////////////////////////////////////////////////
+  // checkFastTrigger(int sensor, long value, bool watching)
+  //
+  // Called with each completed window's sum (DETECT_MEAN) or amplitude.
+  // A window far above the baseline within two windows of one that was
+  // off is a motor starting up. The second window allows for the tool
+  // switching on part way through the first. A level that creeps up, or
+  // a tool that is already running, never sets it off.
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::checkFastTrigger(int sensor, long value, bool watching)
+  {
+    if (value <= fastLow[sensor]) fastSinceLow[sensor] = 0;
+    else if (fastSinceLow[sensor] < 255) fastSinceLow[sensor]++;
+
+    if (watching && value > fastLimit[sensor] && fastSinceLow[sensor] <= 2) {
+      fastPending[sensor] = true;
+      fastSinceLow[sensor] = 255;   // once per rise
+      IPRINT(F("Sensor #")); IPRINT(sensor); IPRINTLN(F(" inrush"));
+    }
+  }
+  #endif
+
+  //////////////////////////////////////////////////////////////////////
+  // FastTriggered(int sensor)
+  //
+  // Returns true once for each motor inrush seen on a sensor that is off.
+  // Triggered() is still what confirms the tool is running.
+  //
+  //////////////////////////////////////////////////////////////////////
+  bool AcSensors::FastTriggered(int sensor)
+  {
+    #if ENABLE_FAST_TRIGGER
+    bool fast = fastPending[sensor];
+    fastPending[sensor] = false;
+    return fast && !sensorState[sensor];
+    #else
+    (void)sensor;
+    return false;
+    #endif
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // updateBackgroundCalibration()
+  //
+  // After a warm boot, take fresh baselines once every tool has been off
+  // for RECALIBRATE_QUIET_MS. A tool turning on abandons the attempt.
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::updateBackgroundCalibration()
+  {
+    bool anyOn = false;
+    for (int x = 0; x < num_ac_sensors && x < NUM_AC_SENSORS; x++)
+      if (sensorState[x]) anyOn = true;
+
+    unsigned long currentTime = millis();
+    if (anyOn)
+    {
+      if (calibrating) {
+        DPRINTLN(F("Tool turned on, background calibration abandoned"));
+      }
+      calibrating = false;
+      quietSince = currentTime;
+      return;
+    }
+
+    if (calibrating)
+    {
+      if (currentTime - calibrationStart >= (unsigned long)numoffmaxsamples) {
+        IPRINTLN(F("Background calibration complete"));
+        finishCalibration();
+      }
+    }
+    else if (currentTime - quietSince >= (unsigned long)recalibrateQuietMs)
+    {
+      DPRINTLN(F("All tools off, starting background calibration"));
+      beginCalibration();
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // addCycleSample(int sensor, int value)
+  //
+  // Add one raw sample to the sensor's mains cycle window. When the window
+  // is full its RMS, peak to peak or mains frequency amplitude is stored in
+  // amplitudeQ4 and true is returned. The square roots are taken once per
+  // window, not per sample.
+  //
+  //////////////////////////////////////////////////////////////////////
+  bool AcSensors::addCycleSample(int sensor, int value)
+  {
+    CycleWindow &w = cycleWindow[sensor];
+    if (w.count == 0) {
+      w.sum = 0;
+      w.sumSquares = 0;
+      w.minValue = value;
+      w.maxValue = value;
+      w.goertzel1 = 0;
+      w.goertzel2 = 0;
+      if (w.bias < 0) w.bias = value;
+    }
+    w.sum += value;
+    w.sumSquares += (long)value * value;
+    if (value < w.minValue) w.minValue = value;
+    if (value > w.maxValue) w.maxValue = value;
+
+    #if DETECTION_MODE == DETECT_GOERTZEL
+    // One Goertzel step on the bias-free sample: s[n] = x + coeff*s[n-1] - s[n-2]
+    long g0 = (value - w.bias) + ((goertzelCoeff * w.goertzel1) >> 14) - w.goertzel2;
+    w.goertzel2 = w.goertzel1;
+    w.goertzel1 = g0;
+    #endif
+
+    if (++w.count < windowSamples) return false;
+
+    #if DETECTION_MODE == DETECT_PEAK_TO_PEAK
+    amplitudeQ4[sensor] = (w.maxValue - w.minValue) << amplitude_shift;
+    #elif DETECTION_MODE == DETECT_GOERTZEL
+    // Mains bin power = s1^2 + s2^2 - coeff*s1*s2, amplitude = 2*sqrt(power)/n
+    float s1 = w.goertzel1;
+    float s2 = w.goertzel2;
+    float power = s1 * s1 + s2 * s2 - (goertzelCoeff / 16384.0) * s1 * s2;
+    amplitudeQ4[sensor] = power > 0 ? (int)(2.0 * (1 << amplitude_shift) * sqrt(power) / w.count) : 0;
+    w.bias = w.sum / w.count;
+    #else
+    // RMS of the swing about the window mean: sqrt(n*sum(x^2) - sum(x)^2) / n
+    long long spread = (long long)w.count * w.sumSquares - (long long)w.sum * w.sum;
+    amplitudeQ4[sensor] = (int)((1 << amplitude_shift) * sqrt((float)spread) / w.count);
+    #endif
+
+    w.count = 0;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // CollectSamples()
+  //
+  // Take the samples the background sampler has buffered for each sensor
+  // and feed them to calibration and the cycle detectors, adding them to
+  // the pass that ReadSensors() will average. Calling this more often than
+  // ReadSensors() keeps the sampler's rings short and the onset times and
+  // cycle based detection current between passes.
+  //
+  //////////////////////////////////////////////////////////////////////
+  void AcSensors::CollectSamples()
+  {
+    for (int cursensor=0; cursensor < num_ac_sensors && cursensor < NUM_AC_SENSORS; cursensor++)
+    {
+       int waiting = AdcSampler::available(cursensor);
+       int count = 0;
+       unsigned long now = millis();
+       while (AdcSampler::available(cursensor) > 0)
+       {
+         int sample = AdcSampler::read(cursensor);
+         passTotal[cursensor] += sample;
+         passCount[cursensor]++;
+         count++;
+         if (processSample(cursensor, sample) && !passAbove[cursensor]) {
+           // Samples are one period apart, so the first one above the threshold was taken this long ago.
+           // Samples that arrived after now was read count as taken now.
+           passAbove[cursensor] = true;
+           int behind = waiting > count ? waiting - count : 0;
+           LatencyStats::onset(cursensor, now - (unsigned long)behind * 1000 / AdcSampler::channelRate());
+         }
+       }
     }
   }
 
   //////////////////////////////////////////////////////////////////////
   // ReadSensors()
   //
-  // Read values for AC current sensors and add to list of values we will average
+  // Collect the background samples for each AC current sensor and add the
+  // average of everything collected since the last pass to the list of
+  // values we will average
   //
   //////////////////////////////////////////////////////////////////////  
   void AcSensors::ReadSensors()
   {
+    CollectSamples();
+
+    int previndex = curreadingindex;
     curreadingindex ++;
-    if (curreadingindex >= avg_readings) curreadingindex =0;
+    if (curreadingindex >= avgWindow) curreadingindex =0;
     
-      // Convert the analog reading (which goes from 0 - 1023) to a voltage (0 - 5V):
     for (int cursensor=0; cursensor < num_ac_sensors && cursensor < NUM_AC_SENSORS; cursensor++)
     {
-       int sensorValue = analogRead(sensorPins[cursensor]);
-       //float voltage = sensorValue * (5.0 / 1023.0);
-       
-       //DPRINT("Reading Sensor ");  
-       //DPRINTLN(cursensor);
-       recentReadings[cursensor][curreadingindex] = sensorValue;
+       // Average every sample the background sampler took since the last pass.
+       // Covering several mains cycles this way also filters out the 50/60Hz ripple.
+       long total = passTotal[cursensor];
+       int count = passCount[cursensor];
+       bool above = passAbove[cursensor];
+       passTotal[cursensor] = 0;
+       passCount[cursensor] = 0;
+       passAbove[cursensor] = false;
+
+       // A whole pass below the threshold, whatever started the last onset has gone
+       if (count > 0 && !above && !sensorState[cursensor]) LatencyStats::cancel(cursensor);
+
+       // No new samples (disabled pin or a very fast loop), repeat the last value
+       int sensorValue = count > 0 ? (int)((total + count / 2) / count) : recentReadings[cursensor].get(previndex);
+
+       // Slide the window: drop the reading being overwritten from the total, add the new one
+       readingTotals[cursensor] += sensorValue - recentReadings[cursensor].get(curreadingindex);
+       recentReadings[cursensor].set(curreadingindex, sensorValue);
     }
-  
+
+    if (recalibrationPending) updateBackgroundCalibration();
   }
 
     
@@ -125,63 +592,62 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
       // Sensor test mode - display only the selected sensor with detailed output
       int testSensor = TEST_SENSOR_INDEX - 1; // Convert to 0-based index
       if (testSensor >= 0 && testSensor < num_ac_sensors) {
-          int avgthissensor = AvgSensorReading(testSensor);
-          float delta = avgthissensor - offReadings[testSensor];
+          int avgthissensor = detectorValue(testSensor) / detectorScale();
+          int delta = avgthissensor - offLevel[testSensor];
           
-          DPRINT("Sensor #");
+          DPRINT(F("Sensor #"));
           DPRINT(TEST_SENSOR_INDEX);
-          DPRINT(" | Raw: ");
+          DPRINT(F(" | Raw: "));
           DPRINT(avgthissensor);
-          DPRINT(" | Baseline: ");
+          DPRINT(F(" | Baseline: "));
           DPRINT(offReadings[testSensor]);
-          DPRINT(" | Delta: ");
+          DPRINT(F(" | Delta: "));
           DPRINT(delta);
-          DPRINT(" | Triggered: ");
-          DPRINTLN(Triggered(testSensor) ? "YES" : "NO");
+          DPRINT(F(" | Triggered: "));
+          DPRINTLN(Triggered(testSensor) ? F("YES") : F("NO"));
           
           // Still control the LED for visual feedback
           if (Triggered(testSensor)) {
-              digitalWrite(ledpin[testSensor], HIGH);
+              GateConfig::writeLed(testSensor, true);
           } else {
-              digitalWrite(ledpin[testSensor], LOW);
+              GateConfig::writeLed(testSensor, false);
           }
       }
       return; // Exit early in sensor test mode
       #endif
       
       #ifdef DEBUG_METER_VERBOSE
-      DPRINTLN("\n--- Meter Mode Readings ---");
+      DPRINTLN(F("\n--- Meter Mode Readings ---"));
       #endif
       
       for (int cursensor= 0; cursensor < num_ac_sensors && cursensor < NUM_AC_SENSORS; cursensor++)
       {
         #ifdef DEBUG_METER_VERBOSE
-        DPRINT("Sensor #"); DPRINT(cursensor + 1); DPRINT(": ");
+        DPRINT(F("Sensor #")); DPRINT(cursensor + 1); DPRINT(F(": "));
         #endif
         
-        int avgthissensor =  AvgSensorReading(cursensor);
-        //float percent = avgthissensor / 4.5;
+        int avgthissensor = detectorValue(cursensor) / detectorScale();
         // Calculate the signal strength relative to baseline
-        float delta = avgthissensor - offReadings[cursensor];
+        int delta = avgthissensor - offLevel[cursensor];
         
         // Only consider positive changes from baseline
-        float percent = 0;
+        int percent = 0;
         if (delta > 0) {
-            percent = delta / (1023 - offReadings[cursensor]);
-            if (percent > 1) percent = 1;
+            percent = (long)delta * 100 / (1023 - offLevel[cursensor]);
+            if (percent > 100) percent = 100;
         }
         
         #ifdef DEBUG_METER_VERBOSE
         // Debug raw values
-        DPRINT(" Raw: "); DPRINT(avgthissensor);
-        DPRINT(" Baseline: "); DPRINT(offReadings[cursensor]);
-        DPRINT(" Delta: "); DPRINT(delta);
+        DPRINT(F(" Raw: ")); DPRINT(avgthissensor);
+        DPRINT(F(" Baseline: ")); DPRINT(offReadings[cursensor]);
+        DPRINT(F(" Delta: ")); DPRINT(delta);
         #endif
         
         // Calculate blink length based on signal strength
         int blinklen = maxblinklen;  // Default to slow blink for no signal
         if (delta > 0) {
-          blinklen = maxblinklen * (1 - (delta / 1023.0));
+          blinklen = (long)maxblinklen * (1023 - delta) / 1023;
           if (blinklen < 10) blinklen = 10;  // Minimum blink time to prevent flicker
         }
         
@@ -192,19 +658,19 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
         if (blinktimers[cursensor] >= blinklen) {
           blinktimers[cursensor] = 0;
           blinkon[cursensor] = !blinkon[cursensor];
-          digitalWrite(ledpin[cursensor], blinkon[cursensor] ? HIGH : LOW);
+          GateConfig::writeLed(cursensor, blinkon[cursensor]);
         }
   
         #ifdef DEBUG_METER_VERBOSE
         // print out the value you read:
         DPRINT(percent);
-        DPRINT("    " );
+        DPRINT(F("    "));
         DPRINT(avgthissensor);
-        DPRINT(" BlinkLen:");
+        DPRINT(F(" BlinkLen:"));
         DPRINT(blinklen);
-        DPRINT(" BlinkTimer:");
+        DPRINT(F(" BlinkTimer:"));
         DPRINT(blinktimers[cursensor]);
-        DPRINTLN("");
+        DPRINTLN();
         #ifdef DEBUG
         //displayaverages(cursensor);
         #endif
@@ -215,18 +681,18 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
           blinktimers[cursensor] = 0;
           if (blinkon[cursensor])
           {
-           digitalWrite(ledpin[cursensor], LOW);
+           GateConfig::writeLed(cursensor, false);
            #ifdef DEBUG_METER_VERBOSE
-           DPRINT("LED OFF " );
+           DPRINT(F("LED OFF "));
            DPRINTLN(cursensor);
            #endif
            blinkon[cursensor]=false;
           }
           else
           {
-           digitalWrite(ledpin[cursensor], HIGH);
+           GateConfig::writeLed(cursensor, true);
            #ifdef DEBUG_METER_VERBOSE
-           DPRINT("LED ON" );
+           DPRINT(F("LED ON"));
            DPRINTLN(cursensor);
            #endif
            blinkon[cursensor] = true;
@@ -251,30 +717,46 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
         long totalsensorval = 0;
         for (int y = 0; y < numoffsamples; y++)
         {      
-          totalsensorval += analogRead(sensorPins[x]);
+          totalsensorval += analogRead(GateConfig::sensorPin(x));
           delay(100);
         }
         offReadings[x] = (float)totalsensorval/ (float)numoffsamples;
-        DPRINT("OFF READING: ");
+        DPRINT(F("OFF READING: "));
         DPRINTLN(offReadings[x]);
     }
+    updateThresholds();
   }
 
   //////////////////////////////////////////////////////////////////////
   // Triggered(int forsensor)
   //
   // Returns true if the given AC current sensor number is triggered
-  // Implements hysteresis and debouncing for flutter protection
+  // In DETECT_MEAN mode each call is one debounce reading of the average,
+  // the cycle based modes are updated by ReadSensors() once per window.
   //////////////////////////////////////////////////////////////////////
   bool AcSensors::Triggered(int forsensor)
   {
-    float avgReading = AvgSensorReading(forsensor);
+    #if DETECTION_MODE == DETECT_MEAN
+    return updateSensorState(forsensor, readingTotals[forsensor]);
+    #else
+    return sensorState[forsensor];
+    #endif
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // updateSensorState(int forsensor, long reading)
+  //
+  // Feed a new detectorValue() through the state machine and return the
+  // resulting state. Implements hysteresis and debouncing for flutter protection
+  //////////////////////////////////////////////////////////////////////
+  bool AcSensors::updateSensorState(int forsensor, long avgReading)
+  {
     bool currentState = sensorState[forsensor];
     
     // Determine threshold based on current state (hysteresis)
-    float threshold = currentState
-      ? offReadings[forsensor] * sensitivityOff   // Use lower threshold when ON (prevents flutter on falling edge)
-      : offReadings[forsensor] * sensitivityOn;    // Use higher threshold when OFF (prevents false triggers)
+    long threshold = currentState
+      ? offLimit[forsensor]   // Use lower threshold when ON (prevents flutter on falling edge)
+      : onLimit[forsensor];   // Use higher threshold when OFF (prevents false triggers)
     
     // Determine desired state based on reading
     bool desiredState = (avgReading > threshold);
@@ -292,13 +774,15 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
     if (debounceCounter[forsensor] >= debounceStableReadings) {
       sensorState[forsensor] = desiredState;
       debounceCounter[forsensor] = 0;
+      if (desiredState) LatencyStats::mark(forsensor, LatencyStats::STAGE_DETECTED);
+      else LatencyStats::cancel(forsensor);
+      TLOG(desiredState ? Telemetry::TM_SENSOR_ON : Telemetry::TM_SENSOR_OFF, forsensor,
+           (int16_t)(avgReading * 10 / detectorScale()), (int16_t)(threshold * 10 / detectorScale()));
       
-      #ifdef DEBUG
-      DPRINT("Sensor #");
-      DPRINT(forsensor);
-      DPRINT(" state changed to ");
-      DPRINTLN(desiredState ? "ON" : "OFF");
-      #endif
+      IPRINT(F("Sensor #"));
+      IPRINT(forsensor);
+      IPRINT(F(" state changed to "));
+      IPRINTLN(desiredState ? F("ON") : F("OFF"));
     }
     
     // Return current state (may not have changed yet due to debouncing)
@@ -313,28 +797,11 @@ const float AcSensors::acsensorsentitivity = AC_SENSOR_SENSITIVITY;
   //////////////////////////////////////////////////////////////////////
   void AcSensors::displayaverages(int cursensor)
   {
-      Serial.print( recentReadings[cursensor][0]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][1]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][2]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][3]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][4]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][5]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][6]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][7]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][8]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][9]);
-      Serial.print(" ");
-      Serial.print( recentReadings[cursensor][0]);
-      Serial.println(" ");
+      for (int x = 0; x < avgWindow; x++) {
+        DPRINT(recentReadings[cursensor].get(x));
+        DPRINT(' ');
+      }
+      DPRINTLN();
   }
   
     
@@ -0,0 +1,148 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "AdcSampler.h"
+#include "GateConfig.h"
+#ifndef __AVR__
+#include "SimShop.h"
+#endif
+
+  static_assert((AdcSampler::ring_size & (AdcSampler::ring_size - 1)) == 0, "ADC_RING_SIZE must be a power of two");
+  static_assert(AdcSampler::ring_size <= 128, "ADC_RING_SIZE must be no more than 128");
+  #ifdef __AVR__
+  static_assert(F_CPU / 32 / ADC_SAMPLE_RATE_HZ <= 256, "ADC_SAMPLE_RATE_HZ too low for Timer2");
+  #endif
+  static_assert(ADC_SAMPLE_RATE_HZ <= 9000, "ADC_SAMPLE_RATE_HZ faster than the ADC can convert");
+
+  // Shared with the interrupt handlers
+  static volatile uint16_t ring[AdcSampler::max_channels][AdcSampler::ring_size];
+  static volatile uint8_t ringHead[AdcSampler::max_channels];   // written by the ISR
+  static volatile uint8_t ringTail[AdcSampler::max_channels];   // written by the main loop
+  static volatile unsigned int droppedSamples = 0;
+  static uint8_t scanChannel[AdcSampler::max_channels];         // channel numbers in scan order
+  static uint8_t scanMux[AdcSampler::max_channels];             // ADC mux input for each scan slot
+  static uint8_t scanPin[AdcSampler::max_channels];             // analog pin for each scan slot (host build)
+  static uint8_t scanCount = 0;
+  static volatile uint8_t scanPos = 0;
+
+  //////////////////////////////////////////////////////////////////////
+  // begin(int count)
+  //
+  // Start free running sampling of the first count sensor pins in
+  // GateConfig. Channel numbers match the gate, pins of -1 are skipped.
+  //////////////////////////////////////////////////////////////////////
+  void AdcSampler::begin(int count)
+  {
+    end();
+
+    scanCount = 0;
+    for (int x = 0; x < count && x < max_channels; x++)
+    {
+      ringHead[x] = 0;
+      ringTail[x] = 0;
+      int pin = GateConfig::sensorPin(x);
+      if (pin == -1) continue;
+      scanChannel[scanCount] = x;
+      scanMux[scanCount] = (pin >= A0 ? pin - A0 : pin) & 0x07;
+      scanPin[scanCount] = pin;
+      scanCount++;
+    }
+    droppedSamples = 0;
+    scanPos = 0;
+    if (scanCount == 0) return;
+
+    #ifdef __AVR__
+    // ADC: AVcc reference (same as analogRead), interrupt on completion, 125kHz ADC clock
+    ADMUX = _BV(REFS0) | scanMux[0];
+    ADCSRA = _BV(ADEN) | _BV(ADIE) | _BV(ADPS2) | _BV(ADPS1) | _BV(ADPS0);
+
+    // Timer2: CTC mode, clk/32, compare match at the aggregate sample rate
+    TCCR2A = _BV(WGM21);
+    TCCR2B = _BV(CS21) | _BV(CS20);
+    OCR2A = F_CPU / 32 / sample_rate - 1;
+    TCNT2 = 0;
+    TIMSK2 = _BV(OCIE2A);
+    #else
+    SimShop::startTimer(sample_rate, sampleTick);
+    #endif
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // end()
+  //
+  // Stop sampling and hand the ADC back to analogRead()
+  //////////////////////////////////////////////////////////////////////
+  void AdcSampler::end()
+  {
+    #ifdef __AVR__
+    TIMSK2 = 0;
+    ADCSRA &= ~_BV(ADIE);
+    #else
+    SimShop::stopTimer(sampleTick);
+    #endif
+  }
+
+  int AdcSampler::available(int channel)
+  {
+    return (uint8_t)(ringHead[channel] - ringTail[channel]);
+  }
+
+  int AdcSampler::read(int channel)
+  {
+    uint8_t tail = ringTail[channel];
+    if (tail == ringHead[channel]) return -1;
+    int value = ring[channel][tail & (ring_size - 1)];
+    ringTail[channel] = tail + 1;
+    return value;
+  }
+
+  unsigned int AdcSampler::overruns()
+  {
+    noInterrupts();
+    unsigned int dropped = droppedSamples;
+    interrupts();
+    return dropped;
+  }
+
+  long AdcSampler::channelRate()
+  {
+    return scanCount ? sample_rate / scanCount : 0;
+  }
+
+  // Store a finished conversion and move on to the next sensor
+  static inline void storeSample(uint16_t value)
+  {
+    uint8_t channel = scanChannel[scanPos];
+    uint8_t head = ringHead[channel];
+
+    if ((uint8_t)(head - ringTail[channel]) < AdcSampler::ring_size) {
+      ring[channel][head & (AdcSampler::ring_size - 1)] = value;
+      ringHead[channel] = head + 1;
+    } else {
+      droppedSamples++;
+    }
+
+    if (++scanPos >= scanCount) scanPos = 0;
+  }
+
+  #ifdef __AVR__
+  // Timer tick: start converting the channel selected by the last conversion
+  ISR(TIMER2_COMPA_vect)
+  {
+    ADCSRA |= _BV(ADSC);
+  }
+
+  // Conversion done: store it and point the mux at the next sensor so it has
+  // a full sample period to settle before the next conversion starts
+  ISR(ADC_vect)
+  {
+    storeSample(ADC);
+    ADMUX = _BV(REFS0) | scanMux[scanPos];
+  }
+  #else
+  // Host build: the simulated shop calls this at the sample rate, the
+  // conversion is instant
+  void AdcSampler::sampleTick()
+  {
+    storeSample(analogRead(scanPin[scanPos]));
+  }
+  #endif
@@ -4,6 +4,14 @@
 #include "Configuration.h"
 #include "GateServos.h"
 #include "AcSensors.h"
+#include "SettingsStore.h"
+#include "TraceCapture.h"
+#include "LatencyStats.h"
+#include "Telemetry.h"
+#include "FastPin.h"
+#include "Scheduler.h"
+#include "ButtonEdges.h"
+#include "AdcSampler.h"
 
 /*  Blast gate servo controller for Arduino
  *   
@@ -32,24 +40,44 @@ unsigned long debounceDelay = 50;    // Debounce time in milliseconds
 unsigned long gateOpenTimer = 0;     // Timer for gate opening delay
 bool gateSelectionActive = false;    // Flag to indicate a gate has been selected and waiting to open
 
+#if ENABLE_FAST_TRIGGER
+// Gates opened on a motor inrush, waiting for the averaged detection to confirm the tool
+bool fastOpened[NUM_AC_SENSORS] = {};
+unsigned long fastOpenedAt[NUM_AC_SENSORS] = {};
+#endif
+
 static const bool has_button = HAS_BUTTON;
 static const int buttonPin = BUTTON_PIN;
 static const bool hasbutton = HAS_BUTTON;  
 
 GateServos gateservos(-1);  // object controlling blast gate servos
 AcSensors acsensors;        // object controlling AC current sensors
+SettingsStore settings;     // baselines and gate positions saved across power cycles
+Scheduler scheduler;        // runs the tasks below, each at its own rate
+
+void sampleTask();
+void motionTask();
+void detectTask();
+void buttonTask();
+void buttonSettled(unsigned long at);
+void ledTask();
+void commissionGates();
 
 void setup() {
-  #ifdef DEBUG
-  Serial.begin(9600);
+  #if LOG_LEVEL > LOG_LEVEL_NONE
+  Log.begin(9600);  // waits for room until the end of setup()
   delay(1000);  // Give serial connection time to establish
-  DPRINTLN("BlastGateServo starting...");
+  IPRINTLN(F("BlastGateServo starting..."));
+  #elif ENABLE_TELEMETRY
+  Telemetry::begin();
+  #else
+  Serial.begin(9600);  // for the serial commands
   #endif
 
   // Set up button pin for all modes
   if (has_button) {
       pinMode(buttonPin, INPUT_PULLUP);
-      delay(100); // Give pin time to stabilize
+      delay(5); // Give pin time to stabilize
       
       // Initialize button state to prevent false detection at startup
       buttonState = digitalRead(buttonPin);
@@ -58,14 +86,21 @@ void setup() {
       gateSelectionActive = false;
       gateOpenTimer = 0;
       
-      DPRINTLN("Button initialized");
+      ButtonEdges::begin();
+      DPRINTLN(F("Button initialized"));
   }
 
+  #ifdef TRACE_CAPTURE
+  // Capture builds only stream raw sensor samples for tools/replay
+  TraceCapture::begin();
+  return;
+  #endif
+
   #ifdef DEBUG_SERVO_TEST
   // For servo test mode, we only need to set up the button
   // and initialize the servo pin for the selected servo
-  DPRINT("Servo Test Mode Active - Press button to toggle servo ");
-  DPRINTLN(TEST_SERVO_INDEX);
+  IPRINT(F("Servo Test Mode Active - Press button to toggle servo "));
+  IPRINTLN(TEST_SERVO_INDEX);
   
   // Initialize just the LED pin for the selected servo
   int ledPin;
@@ -89,7 +124,7 @@ void setup() {
   // Check for meter mode
   if (has_button && digitalRead(buttonPin) == LOW) {
       metermode = true;
-      DPRINTLN("Entering meter mode - Use LEDs to calibrate AC sensor positions");
+      IPRINTLN(F("Entering meter mode - Use LEDs to calibrate AC sensor positions"));
   } else {
       metermode = false;
   }
@@ -100,20 +135,35 @@ void setup() {
   
   #ifdef DEBUG_SENSOR_TEST
       metermode = true;
-      DPRINTLN("Entering sensor test mode");
+      IPRINTLN(F("Entering sensor test mode"));
   #endif
 
+  // A valid saved record lets us skip calibration and homing of closed gates
+  bool loaded = settings.load();
+  bool warmboot = ENABLE_WARM_BOOT && loaded;
+  TLOG(Telemetry::TM_BOOT, (int16_t)warmboot);
+
+  // Travel times measured with the m command are used whether or not warm boot is on
+  if (loaded) {
+      memcpy(gateservos.travelOpenMs, settings.travelOpenMs(), sizeof(gateservos.travelOpenMs));
+      memcpy(gateservos.travelCloseMs, settings.travelCloseMs(), sizeof(gateservos.travelCloseMs));
+  }
+
   // Initialize sensors before anything else
-  acsensors.InitializeSensors();
+  if (warmboot && settings.hasBaselines()) {
+      acsensors.InitializeSensors(settings.offReadings());
+  } else {
+      acsensors.InitializeSensors();
+  }
 
   // Initialize gates if not in meter mode
   if (!metermode) {
-      gateservos.initializeGates();
+      gateservos.initializeGates(warmboot ? settings.gatePositions() : NULL);
   }
 
   #if !ENABLE_AC_SENSORS
   // Print this message only once during setup
-  DPRINTLN("AC sensors disabled - using manual control only");
+  IPRINTLN(F("AC sensors disabled - using manual control only"));
   #endif
 
   #ifdef DEBUG_LED_TEST
@@ -131,47 +181,447 @@ void setup() {
   digitalWrite(LED_PIN_4, LOW);
   digitalWrite(LED_PIN_5, LOW);
   
-  DPRINTLN("LED Test Mode Active - Press button to light all LEDs");
+  IPRINTLN(F("LED Test Mode Active - Press button to light all LEDs"));
   #endif
   // Note: Removed duplicate initialization
+
+  // Each job of loop() runs at its own rate, earlier tasks first when several are due
+  // (Scheduler::max_tasks has room for exactly these five)
+  #if ENABLE_AC_SENSORS
+  scheduler.add(F("sample"), sampleTask, 1000000UL / TASK_SAMPLE_HZ);
+  #endif
+  scheduler.add(F("motion"), motionTask, 1000000UL / TASK_MOTION_HZ);
+  #if ENABLE_AC_SENSORS
+  // The meter blink timers count readings, so meter mode takes one about every millisecond
+  scheduler.add(F("detect"), detectTask, metermode ? 1000UL : 1000000UL / TASK_DETECT_HZ);
+  #endif
+  if (hasbutton && !metermode) scheduler.add(F("button"), buttonTask, 1000000UL / TASK_BUTTON_HZ);
+  scheduler.add(F("leds"), ledTask, 1000000UL / TASK_LED_HZ);
+
+  // From here on log messages are dropped rather than holding up loop()
+  Log.setBlocking(false);
 }
 
 
-void loop()
+//////////////////////////////////////////////////////////////////////
+// checkSerialCommands()
+//
+// Single letter commands from the serial monitor:
+//   l - print the tool on to gate open latency statistics
+//   t - print how often each task ran and its overruns
+//   c - clear both
+//   m - measure and save each gate's travel times (needs SERVO_CURRENT_PIN)
+// Telemetry builds only take m and send its results as TM_TRAVEL_TIME
+// events, text would be mixed into the binary frames.
+//////////////////////////////////////////////////////////////////////
+#if ENABLE_TELEMETRY
+#define REPLY(...)    do {} while (0)
+#define REPLYLN(...)  do {} while (0)
+#else
+#define REPLY(...)    Serial.print(__VA_ARGS__)
+#define REPLYLN(...)  Serial.println(__VA_ARGS__)
+#endif
+
+void checkSerialCommands()
 {
-  // Check for error state and display error pattern
-  if (gateservos.isInErrorState()) {
-    // Flash all LEDs rapidly to indicate error
-    static unsigned long lastFlash = 0;
-    static bool flashState = false;
+  while (Serial.available() > 0) {
+    switch (Serial.read()) {
+      #if !ENABLE_TELEMETRY
+      case 'l': LatencyStats::dump(Serial); break;
+      case 't': scheduler.dump(Serial); break;
+      case 'c': LatencyStats::clear(); scheduler.clearStats(); Serial.println(F("Latency and task statistics cleared")); break;
+      #endif
+      case 'm': commissionGates(); break;
+    }
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// commissionGates()
+//
+// Time every gate's open and close moves from the servo supply current
+// and save them, so moves are held for as long as each gate really takes.
+// Sensor sampling stops while it runs (a few seconds per gate), so it
+// is only done with all tools off. Every gate is left closed.
+//////////////////////////////////////////////////////////////////////
+void commissionGates()
+{
+  if (SERVO_CURRENT_PIN == -1) {
+    REPLYLN(F("Set SERVO_CURRENT_PIN to measure gate travel times"));
+    return;
+  }
+  if (toolon || metermode || !gateservos.isMotionIdle() || gateservos.isInErrorState()) {
+    REPLYLN(F("Gates busy, measure travel times with all tools off"));
+    return;
+  }
+
+  REPLYLN(F("Gate travel times (ms)"));
+  #if ENABLE_AC_SENSORS
+  AdcSampler::end();   // the current is read with analogRead()
+  #endif
+  for (int gate = 0; gate < gateservos.num_gates; gate++) {
+    if (gateservos.isGateDisabled(gate)) continue;
+    gateservos.ledon(gate);
+    bool measured = gateservos.measureTravel(gate);
+    gateservos.ledoff(gate);
+    gateservos.gateopen[gate] = false;
+
+    TLOG(Telemetry::TM_TRAVEL_TIME, gate, (int16_t)(measured ? gateservos.travelOpenMs[gate] : 0),
+         (int16_t)(measured ? gateservos.travelCloseMs[gate] : 0));
+    REPLY(F("  gate ")); REPLY(gate + 1);
+    if (measured) {
+      REPLY(F(": open ")); REPLY(gateservos.travelOpenMs[gate]);
+      REPLY(F(", close ")); REPLYLN(gateservos.travelCloseMs[gate]);
+    } else {
+      REPLYLN(F(": never settled, keeping OPEN_DELAY and CLOSE_DELAY"));
+    }
+  }
+  #if ENABLE_AC_SENSORS
+  AdcSampler::begin(acsensors.num_ac_sensors);
+  #endif
+
+  gateservos.curopengate = -1;
+  curselectedgate = -1;
+  gateSelectionActive = false;
+  settings.saveTravelTimes(gateservos.travelOpenMs, gateservos.travelCloseMs);
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// sampleTask()
+//
+// Move the sensor samples taken in the background into the detectors
+//////////////////////////////////////////////////////////////////////
+void sampleTask()
+{
+  if (gateservos.isInErrorState()) return;
+  acsensors.CollectSamples();
+
+  #if ENABLE_FAST_TRIGGER
+  // A motor starting up opens its gate straight away, detectTask() confirms or retracts it
+  for (int cursensor=0; cursensor < acsensors.num_ac_sensors && cursensor < NUM_AC_SENSORS; cursensor++)
+  {
+    if (!acsensors.FastTriggered(cursensor) || gateservos.gateopen[cursensor]) continue;
+
+    IPRINT(F(" TOOL STARTING #")); IPRINTLN(cursensor);
+    TLOG(Telemetry::TM_FAST_OPEN, (int16_t)cursensor);
+    fastOpened[cursensor] = true;
+    fastOpenedAt[cursensor] = millis();
+    gateSelectionActive = false;
+    toolon = true;
+    curselectedgate = cursensor;
+    gateservos.gateopen[cursensor] = true;
+    gateservos.ledon(cursensor);
+    gateservos.opengate(cursensor);
+  }
+  #endif
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// motionTask()
+//
+// Keep servo moves progressing, run queued gate operations once their
+// gate may move again and save the settings for a warm boot
+//////////////////////////////////////////////////////////////////////
+void motionTask()
+{
+  // Keep any servo moves progressing, this never blocks
+  gateservos.updateMotion();
+  if (gateservos.isInErrorState()) return;
+
+  // Process any queued servo operations (flutter protection)
+  gateservos.processQueuedOperations();
+
+  #if ENABLE_WARM_BOOT
+  // Keep the saved record current so the next power up can be a warm boot
+  if (gateservos.positionsChanged) {
+    gateservos.positionsChanged = false;
+    settings.saveGatePositions(gateservos.gateposition);
+  }
+  if (acsensors.BaselinesChanged()) {
+    float offReadings[NUM_AC_SENSORS];
+    for (int x = 0; x < NUM_AC_SENSORS; x++) offReadings[x] = acsensors.GetOffReading(x);
+    settings.saveBaselines(offReadings);
+  }
+  #endif
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// detectTask()
+//
+// One averaging and debounce reading of every sensor. Opens the gate of
+// a tool that has started and closes the gate of one that has stopped,
+// or shows the sensor levels on the LEDs in meter mode.
+//////////////////////////////////////////////////////////////////////
+void detectTask()
+{
+  if (gateservos.isInErrorState()) return;
+
+  acsensors.ReadSensors(); // read all the AC current sensors
+  
+  if (metermode) {
+    acsensors.DisplayMeter();  // if user put device into meter mode, use LED lights to display sensor signal.
+    return; // Don't process any other logic in meter mode
+  }
+
+  toolon = false;
+  for (int cursensor=0; cursensor < acsensors.num_ac_sensors && cursensor < NUM_AC_SENSORS; cursensor++)
+  {
+      // This sensor is triggered by power tool
+      //
+      if (acsensors.Triggered(cursensor))
+      {
+        #if ENABLE_FAST_TRIGGER
+        fastOpened[cursensor] = false;  // the averaged detection agrees, the gate stays open
+        #endif
+
+        // this tool is active, output info to debug
+        DPRINT(F(" TOOL ON #")); DPRINT(cursensor); DPRINT(F(" OFF READING:")); DPRINT(acsensors.GetOffReading(cursensor)); DPRINT(F(" AVG SENSOR READING:")); DPRINTLN(acsensors.GetAvgReading(cursensor));
+
+        // ignore button if tool detected
+        gateSelectionActive = false;
+        toolon = true;
+        if (curselectedgate != cursensor) curselectedgate = cursensor;
+
+        // Gate hasn't been opened yet, open it
+        if (gateservos.gateopen[cursensor] != true)
+        {
+          gateservos.gateopen[cursensor] = true;
+          gateservos.ledon(cursensor);
+          gateservos.opengate(cursensor);
+        }
+      }
+      #if ENABLE_FAST_TRIGGER
+      else if (fastOpened[cursensor] && millis() - fastOpenedAt[cursensor] < FAST_TRIGGER_CONFIRM_MS)
+      {
+        // Opened on an inrush, give the averaged detection time to catch up
+        toolon = true;
+      }
+      #endif
+      else
+      {
+        #if ENABLE_FAST_TRIGGER
+        if (fastOpened[cursensor]) {
+          fastOpened[cursensor] = false;
+          IPRINT(F(" TOOL NOT CONFIRMED #")); IPRINTLN(cursensor);
+          TLOG(Telemetry::TM_FAST_RETRACT, (int16_t)cursensor);
+          LatencyStats::cancel(cursensor);
+        }
+        #endif
+
+        // this tool is not active and gate hasn't been closed yet. Close it.
+        if (gateservos.gateopen[cursensor])
+        {
+          gateservos.gateopen[cursensor] = false;
+          gateservos.ledoff(cursensor);
+          IPRINT(F(" TOOL OFF #")); IPRINTLN(cursensor);
+          gateservos.closegate(cursensor);
+          curselectedgate = gateservos.firstgateopen();  // change currently active gate to first open one
+        }
+      }
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// buttonSettled(unsigned long at)
+//
+// The button has held its last level for the debounce time, as of the
+// given millis(). Step the selection to the next gate on a press and
+// start the open timer on a release.
+//////////////////////////////////////////////////////////////////////
+void buttonSettled(unsigned long at)
+{
+  if (lastButtonState == buttonState) return;
+  buttonState = lastButtonState;
+
+  // Button pressed (LOW with pull-up resistor)
+  if (buttonState == LOW) {
+    // Show the previous selection before changing it
+    if (curselectedgate == -1) {
+      IPRINTLN(F("Button Pressed - Previous selection: All gates closed"));
+    } else {
+      IPRINT(F("Button Pressed - Previous selection: Gate #"));
+      IPRINTLN(curselectedgate + 1);
+    }
     
-    if (millis() - lastFlash >= ERROR_FLASH_INTERVAL_MS) {
-      flashState = !flashState;
-      lastFlash = millis();
+    // Turn off LED for previous selection
+    gateservos.ledoff(curselectedgate);
+    
+    // Move to next gate, skipping disabled gates
+    do {
+      curselectedgate++;
+      if (curselectedgate == gateservos.num_gates)
+        curselectedgate = -1;
+    } while (curselectedgate >= 0 && gateservos.isGateDisabled(curselectedgate));
+    
+    TLOG(Telemetry::TM_BUTTON, (int16_t)curselectedgate);
+
+    // Turn on LED for the selected gate (if not "all closed" option)
+    if (curselectedgate >= 0)
+      gateservos.ledon(curselectedgate);
+    
+    // Display new selection that will be opened after delay
+    if (curselectedgate == -1) {
+      IPRINTLN(F("New selection: All gates closed (will close all gates after delay)"));
+    } else {
+      IPRINT(F("New selection: Gate #"));
+      IPRINTLN(curselectedgate + 1);
+      IPRINTLN(F("(will open after delay)"));
+    }
+  }
+  // Button released (HIGH with pull-up resistor)
+  else {
+    DPRINTLN(F("Button released, starting gate open timer"));
+    gateSelectionActive = true;
+    gateOpenTimer = at;   // from the release itself, however late this task ran
+  }
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// buttonTask()
+//
+// Debounce the edges captured by the pin change interrupt in the order
+// they happened, so a press is counted even if it was over before this
+// task ran, and open the selected gate once the button has been left
+// alone for opendelay
+//////////////////////////////////////////////////////////////////////
+void buttonTask()
+{
+  ButtonEdges::Edge edge;
+
+  // Ignore the button while a tool is running or the system has stopped,
+  // but keep track of its level so a stale press isn't acted on later
+  if (toolon || gateservos.isInErrorState()) {
+    while (ButtonEdges::read(edge)) {
+      lastButtonState = edge.level;
+      lastDebounceTime = edge.time;
+    }
+    if (ButtonEdges::overflowed()) {
+      lastButtonState = FastPin::read<BUTTON_PIN>();
+      lastDebounceTime = millis();
+    }
+    return;
+  }
+
+  // A level that held for the debounce time before the next edge counts,
+  // shorter ones are contact bounce
+  while (ButtonEdges::read(edge)) {
+    if (edge.time - lastDebounceTime > debounceDelay) buttonSettled(lastDebounceTime + debounceDelay);
+    lastButtonState = edge.level;
+    lastDebounceTime = edge.time;
+  }
+
+  // Bounce filled the queue and some edges were lost, go by the pin from now
+  if (ButtonEdges::overflowed()) {
+    DPRINTLN(F("Button edges dropped"));
+    lastButtonState = FastPin::read<BUTTON_PIN>();
+    lastDebounceTime = millis();
+  }
+
+  // The latest level has held since its edge
+  if (millis() - lastDebounceTime > debounceDelay) buttonSettled(lastDebounceTime + debounceDelay);
+  
+  // If a gate is selected and we're waiting for the delay to open it
+  if (gateSelectionActive) {
+    // Calculate elapsed time
+    unsigned long elapsedTime = millis() - gateOpenTimer;
+    
+    // Debug output every 200ms to avoid flooding serial
+    if (elapsedTime % 200 < 1000 / TASK_BUTTON_HZ) {
+      DPRINT(F("Timer: "));
+      DPRINTLN(elapsedTime);
       
-      // Flash all LEDs
-      for (int i = 0; i < gateservos.num_gates; i++) {
-        if (flashState) {
-          gateservos.ledon(i);
-        } else {
-          gateservos.ledoff(i);
-        }
+      DPRINT(F("Current selected gate: "));
+      if (curselectedgate == -1) {
+        DPRINTLN(F("All gates closed"));
+      } else {
+        DPRINTLN(curselectedgate + 1);
       }
       
-      // Print error message periodically (every 10 flashes)
-      static int flashCount = 0;
-      flashCount++;
-      if (flashCount >= 10) {
-        DPRINTLN("ERROR STATE: System halted due to excessive servo operations");
-        DPRINTLN("Restart required to resume operation");
-        flashCount = 0;
+      DPRINT(F("Current open gate: "));
+      if (gateservos.curopengate == -1) {
+        DPRINTLN(F("None"));
+      } else {
+        DPRINTLN(gateservos.curopengate + 1);
       }
+      
+      DPRINT(F("Threshold: "));
+      DPRINTLN(gateservos.opendelay);
     }
     
-    // Do not process any other logic when in error state
-    return;
+    // Open the gate when we reach the threshold
+    if (elapsedTime >= gateservos.opendelay) {
+      DPRINTLN(F("Opening gate after delay"));
+      
+      // Debug the gate we're about to open
+      if (curselectedgate == -1) {
+        DPRINTLN(F("Opening: All gates closed"));
+      } else {
+        DPRINT(F("Opening: Gate #"));
+        DPRINTLN(curselectedgate + 1);
+      }
+      
+      // Call the function to open/close gates
+      gateservos.ManuallyOpenGate(curselectedgate);
+      
+      // Reset gate selection
+      gateSelectionActive = false;
+    }
   }
+}
+
+
+//////////////////////////////////////////////////////////////////////
+// ledTask()
+//
+// Flash every LED while in the error state and answer serial commands
+//////////////////////////////////////////////////////////////////////
+void ledTask()
+{
+  checkSerialCommands();
+
+  // Check for error state and display error pattern
+  if (!gateservos.isInErrorState()) return;
+
+  // Flash all LEDs rapidly to indicate error
+  static unsigned long lastFlash = 0;
+  static bool flashState = false;
   
+  if (millis() - lastFlash >= ERROR_FLASH_INTERVAL_MS) {
+    flashState = !flashState;
+    lastFlash = millis();
+    
+    // Flash all LEDs
+    gateservos.allLeds(flashState);
+    
+    // Print error message periodically (every 10 flashes)
+    static int flashCount = 0;
+    flashCount++;
+    if (flashCount >= 10) {
+      EPRINTLN(F("ERROR STATE: System halted due to excessive servo operations"));
+      EPRINTLN(F("Restart required to resume operation"));
+      flashCount = 0;
+    }
+  }
+  
+}
+
+
+void loop()
+{
+  #ifdef TRACE_CAPTURE
+  TraceCapture::poll();
+  return;
+  #endif
+
+  // Send whatever log output the serial port has room for
+  Log.poll();
+
   #ifdef DEBUG_LED_TEST
   // LED test pattern - flash each LED in sequence or all on when button pressed
   static int currentLed = 0;
@@ -180,7 +630,7 @@ void loop()
 
   // Check button state (LOW when pressed due to pull-up resistor)
   int btnState = digitalRead(BUTTON_PIN);
-  DPRINT("Button state: ");
+  DPRINT(F("Button state: "));
   DPRINTLN(btnState);
   
   if (btnState == LOW) {
@@ -270,19 +720,19 @@ void loop()
     }
     
     // Print debug info about the selected servo (only once)
-    DPRINT("Servo ");
+    DPRINT(F("Servo "));
     DPRINT(TEST_SERVO_INDEX);
-    DPRINT(" configuration - Pin: ");
+    DPRINT(F(" configuration - Pin: "));
     DPRINT(servoPin);
-    DPRINT(", Max (closed): ");
+    DPRINT(F(", Max (closed): "));
     DPRINT(servoMax);
-    DPRINT(", Min (open): ");
+    DPRINT(F(", Min (open): "));
     DPRINTLN(servoMin);
     
     // Add a warning if the servo pin is disabled
     if (servoPin == -1) {
-      DPRINTLN("WARNING: Selected servo pin is disabled (-1)");
-      DPRINTLN("LED will still work but servo will not move");
+      WPRINTLN(F("WARNING: Selected servo pin is disabled (-1)"));
+      WPRINTLN(F("LED will still work but servo will not move"));
     }
     
     configPrinted = true;
@@ -293,14 +743,14 @@ void loop()
   
   // Button state changed from HIGH to LOW (button pressed)
   if (btnState == LOW && lastButtonState == HIGH) {
-    DPRINTLN("Button pressed in servo test mode");
+    DPRINTLN(F("Button pressed in servo test mode"));
     
     // Toggle servo state and LED
     if (servoOpen) {
       // Close the servo
-      DPRINT("Closing servo ");
+      DPRINT(F("Closing servo "));
       DPRINT(TEST_SERVO_INDEX);
-      DPRINT(" - Setting position to ");
+      DPRINT(F(" - Setting position to "));
       DPRINTLN(servoMax);
       digitalWrite(ledPin, LOW);
       
@@ -311,18 +761,18 @@ void loop()
         testServo.write(servoMax);
         delay(CLOSE_DELAY);
         testServo.detach();
-        DPRINTLN("Servo closed");
+        DPRINTLN(F("Servo closed"));
       } else {
-        DPRINTLN("Skipped servo (pin disabled)");
+        DPRINTLN(F("Skipped servo (pin disabled)"));
         delay(CLOSE_DELAY); // still delay for consistency
       }
       
       servoOpen = false;
     } else {
       // Open the servo
-      DPRINT("Opening servo ");
+      DPRINT(F("Opening servo "));
       DPRINT(TEST_SERVO_INDEX);
-      DPRINT(" - Setting position to ");
+      DPRINT(F(" - Setting position to "));
       DPRINTLN(servoMin);
       digitalWrite(ledPin, HIGH);
       
@@ -333,9 +783,9 @@ void loop()
         testServo.write(servoMin);
         delay(OPEN_DELAY);
         testServo.detach();
-        DPRINTLN("Servo opened");
+        DPRINTLN(F("Servo opened"));
       } else {
-        DPRINTLN("Skipped servo (pin disabled)");
+        DPRINTLN(F("Skipped servo (pin disabled)"));
         delay(OPEN_DELAY); // still delay for consistency
       }
       
@@ -349,176 +799,6 @@ void loop()
   return; // Skip normal operation when in servo test mode
   #endif
 
-  bool toolon = false; // indicates if there is any current sensed
-  
-  // Process any queued servo operations (flutter protection)
-  gateservos.processQueuedOperations();
-
-  #if ENABLE_AC_SENSORS
-  // Only process AC sensors if they are enabled
-  acsensors.ReadSensors(); // read all the AC current sensors
-  
-  if (metermode) {
-      acsensors.DisplayMeter();  // if user put device into meter mode, use LED lights to display sensor signal.
-      return; // Don't process any other logic in meter mode
-  }
-  else // not meter mode
-  {
-    for (int cursensor=0; cursensor < acsensors.num_ac_sensors && cursensor < NUM_AC_SENSORS; cursensor++)
-    {
-        // This sensor is triggered by power tool
-        //
-        if (acsensors.Triggered(cursensor))
-        {
-          // this tool is active, output info to debug
-          DPRINT(" TOOL ON #"); DPRINT(cursensor); DPRINT(" OFF READING:"); DPRINT(acsensors.GetOffReading(cursensor)); DPRINT(" AVG SENSOR READING:"); DPRINTLN(acsensors.GetAvgReading(cursensor));
-
-          // ignore button if tool detected
-          gateSelectionActive = false;
-          toolon = true;
-          if (curselectedgate != cursensor) curselectedgate = cursensor;
-
-          // Gate hasn't been opened yet, open it
-          if (gateservos.gateopen[cursensor] != true)
-          {
-            gateservos.gateopen[cursensor] = true;
-            gateservos.ledon(cursensor);
-            gateservos.opengate(cursensor);
-          }
-        }
-        else
-        {
-          // this tool is not active and gate hasn't been closed yet. Close it.
-          if (gateservos.gateopen[cursensor])
-          {
-            gateservos.gateopen[cursensor] = false;
-            gateservos.ledoff(cursensor);
-            DPRINT(" TOOL OFF #"); DPRINTLN(cursensor);
-            gateservos.closegate(cursensor);
-            curselectedgate = gateservos.firstgateopen();  // change currently active gate to first open one
-          }
-        }
-    }
-  }
-  #else
-  // AC sensors are disabled, only manual control is available
-  // Debug message moved to setup
-  #endif
-
-    // Button handling with debounce and state machine
-    if (hasbutton && !toolon) {
-      // Read the current button state
-      int reading = digitalRead(buttonPin);
-      
-      // Check if button state has changed
-      if (reading != lastButtonState) {
-        // Reset debounce timer
-        lastDebounceTime = millis();
-      }
-      
-      // If button state has been stable for debounce period
-      if ((millis() - lastDebounceTime) > debounceDelay) {
-        // If button state has changed since last stable reading
-        if (reading != buttonState) {
-          buttonState = reading;
-          
-          // Button pressed (LOW with pull-up resistor)
-          if (buttonState == LOW) {
-            // Show the previous selection before changing it
-            if (curselectedgate == -1) {
-              DPRINTLN("Button Pressed - Previous selection: All gates closed");
-            } else {
-              DPRINT("Button Pressed - Previous selection: Gate #");
-              DPRINTLN(curselectedgate + 1);
-            }
-            
-            // Turn off LED for previous selection
-            gateservos.ledoff(curselectedgate);
-            
-            // Move to next gate, skipping disabled gates
-            do {
-              curselectedgate++;
-              if (curselectedgate == gateservos.num_gates)
-                curselectedgate = -1;
-            } while (curselectedgate >= 0 && gateservos.isGateDisabled(curselectedgate));
-            
-            // Turn on LED for the selected gate (if not "all closed" option)
-            if (curselectedgate >= 0)
-              gateservos.ledon(curselectedgate);
-            
-            // Display new selection that will be opened after delay
-            if (curselectedgate == -1) {
-              DPRINTLN("New selection: All gates closed (will close all gates after delay)");
-            } else {
-              DPRINT("New selection: Gate #");
-              DPRINTLN(curselectedgate + 1);
-              DPRINTLN("(will open after delay)");
-            }
-          }
-          // Button released (HIGH with pull-up resistor)
-          else if (buttonState == HIGH) {
-            DPRINTLN("Button released, starting gate open timer");
-            gateSelectionActive = true;
-            gateOpenTimer = millis();
-          }
-        }
-      }
-      
-      // Update last button state
-      lastButtonState = reading;
-      
-      // If a gate is selected and we're waiting for the delay to open it
-      if (gateSelectionActive) {
-        // Calculate elapsed time
-        unsigned long elapsedTime = millis() - gateOpenTimer;
-        
-        // Debug output every 200ms to avoid flooding serial
-        if (elapsedTime % 200 < 50) {
-          DPRINT("Timer: ");
-          DPRINTLN(elapsedTime);
-          
-          DPRINT("Current selected gate: ");
-          if (curselectedgate == -1) {
-            DPRINTLN("All gates closed");
-          } else {
-            DPRINTLN(curselectedgate + 1);
-          }
-          
-          DPRINT("Current open gate: ");
-          if (gateservos.curopengate == -1) {
-            DPRINTLN("None");
-          } else {
-            DPRINTLN(gateservos.curopengate + 1);
-          }
-          
-          DPRINT("Threshold: ");
-          DPRINTLN(gateservos.opendelay);
-        }
-        
-        // Open the gate when we reach the threshold
-        if (elapsedTime >= gateservos.opendelay) {
-          DPRINTLN("Opening gate after delay");
-          
-          // Debug the gate we're about to open
-          if (curselectedgate == -1) {
-            DPRINTLN("Opening: All gates closed");
-          } else {
-            DPRINT("Opening: Gate #");
-            DPRINTLN(curselectedgate + 1);
-          }
-          
-          // Call the function to open/close gates
-          gateservos.ManuallyOpenGate(curselectedgate);
-          
-          // Reset gate selection
-          gateSelectionActive = false;
-        }
-      }
-    }
-  
-  if (metermode)
-   delay(1);  // minimal delay while metering so we can collect as many samples as possible
-  else
-   delay(50);
-  
-}
\ No newline at end of file
+  // Run whichever task is due, or sleep until one is
+  scheduler.run();
+}
@@ -0,0 +1,106 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "ButtonEdges.h"
+#include "FastPin.h"
+#ifndef __AVR__
+#include "SimShop.h"
+#endif
+
+  static_assert((ButtonEdges::queue_size & (ButtonEdges::queue_size - 1)) == 0, "BUTTON_EDGE_QUEUE must be a power of two");
+  static_assert(ButtonEdges::queue_size <= 128, "BUTTON_EDGE_QUEUE must be no more than 128");
+
+  // Shared with the interrupt handler
+  static volatile uint16_t edgeTime[ButtonEdges::queue_size];
+  static volatile uint8_t edgeLevel[ButtonEdges::queue_size];
+  static volatile uint8_t edgeHead = 0;        // written by the ISR
+  static volatile uint8_t edgeTail = 0;        // written by the button task
+  static volatile uint8_t lastLevel = HIGH;    // level after the last recorded edge
+  static volatile bool dropped = false;
+  static volatile unsigned int droppedEdges = 0;
+
+  //////////////////////////////////////////////////////////////////////
+  // begin()
+  //
+  // Take the pin's current level as the starting point and enable the
+  // pin change interrupt for BUTTON_PIN
+  //////////////////////////////////////////////////////////////////////
+  void ButtonEdges::begin()
+  {
+    edgeHead = 0;
+    edgeTail = 0;
+    dropped = false;
+    droppedEdges = 0;
+    lastLevel = FastPin::read<BUTTON_PIN>();
+
+    #ifdef __AVR__
+    *digitalPinToPCMSK(BUTTON_PIN) |= _BV(digitalPinToPCMSKbit(BUTTON_PIN));
+    PCIFR = _BV(digitalPinToPCICRbit(BUTTON_PIN));   // forget any change before now
+    PCICR |= _BV(digitalPinToPCICRbit(BUTTON_PIN));
+    #else
+    SimShop::attachPinChange(BUTTON_PIN, pinChanged);
+    #endif
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // read(Edge &edge)
+  //
+  // Take the oldest edge off the queue, widening its 16 bit time back
+  // to a full millis() value
+  //////////////////////////////////////////////////////////////////////
+  bool ButtonEdges::read(Edge &edge)
+  {
+    uint8_t tail = edgeTail;
+    if (tail == edgeHead) return false;
+    uint16_t stamp = edgeTime[tail & (queue_size - 1)];
+    edge.level = edgeLevel[tail & (queue_size - 1)];
+    edgeTail = tail + 1;
+
+    unsigned long now = millis();
+    edge.time = now - (uint16_t)((uint16_t)now - stamp);
+    return true;
+  }
+
+  bool ButtonEdges::overflowed()
+  {
+    noInterrupts();
+    bool was = dropped;
+    dropped = false;
+    interrupts();
+    return was;
+  }
+
+  unsigned int ButtonEdges::overruns()
+  {
+    noInterrupts();
+    unsigned int count = droppedEdges;
+    interrupts();
+    return count;
+  }
+
+  // Record the new level if it changed. Runs with interrupts off.
+  void ButtonEdges::pinChanged()
+  {
+    uint8_t level = FastPin::read<BUTTON_PIN>();
+    if (level == lastLevel) return;   // a bounce too short to see, or another pin on the port
+    lastLevel = level;
+
+    uint8_t head = edgeHead;
+    if ((uint8_t)(head - edgeTail) < queue_size) {
+      edgeTime[head & (queue_size - 1)] = millis();
+      edgeLevel[head & (queue_size - 1)] = level;
+      edgeHead = head + 1;
+    } else {
+      dropped = true;
+      droppedEdges++;
+    }
+  }
+
+  #ifdef __AVR__
+  // One handler for whichever port the button is on, begin() only enables that one
+  ISR(PCINT0_vect)
+  {
+    ButtonEdges::pinChanged();
+  }
+  ISR(PCINT1_vect, ISR_ALIASOF(PCINT0_vect));
+  ISR(PCINT2_vect, ISR_ALIASOF(PCINT0_vect));
+  #endif
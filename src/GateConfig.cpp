@@ -0,0 +1,11 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "GateConfig.h"
+
+  #define GATE_ROW(n) GateConfig::row(SERVO_PIN_##n, LED_PIN_##n, AC_SENSOR_PIN_##n, SERVO_MAX_##n, SERVO_MIN_##n, GATE_CLOSED_AT_MAX_##n, \
+                                      SERVO_SPEED_##n, SERVO_ACCEL_##n)
+
+  const GateConfig::Row GateConfig::table[GateConfig::max_gates] PROGMEM = {
+    GATE_ROW(1), GATE_ROW(2), GATE_ROW(3), GATE_ROW(4), GATE_ROW(5), GATE_ROW(6), GATE_ROW(7), GATE_ROW(8),
+    GATE_ROW(9), GATE_ROW(10), GATE_ROW(11), GATE_ROW(12), GATE_ROW(13), GATE_ROW(14), GATE_ROW(15), GATE_ROW(16)
+  };
@@ -1,8 +1,15 @@
 #include "Arduino.h"
-#include <Servo.h>
 #include "Debug.h"
 #include "Configuration.h"
 #include "GateServos.h"
+#include "LatencyStats.h"
+#include "Telemetry.h"
+
+  static_assert(MAX_CONCURRENT_SERVOS >= 1, "MAX_CONCURRENT_SERVOS must allow at least one servo to move");
+
+  // Per pair swap overlaps from Configuration.h, gates numbered from 1, kept in flash
+  struct SwapOverlap { int8_t from; int8_t to; uint8_t percent; };
+  static const SwapOverlap swapOverlaps[] PROGMEM = SWAP_OVERLAP_PAIRS;
 
   // Constructor.. usually called with -1 to indicate no gates are open
   //
@@ -15,8 +22,12 @@
       operationTimes[i] = 0;
     }
     
+    for (int i = 0; i < num_gates; i++) {
+      gateposition[i] = GATE_POSITION_UNKNOWN;
+    }
+    
     // Initialize queued operations
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < gate_rows; i++) {
       queuedOps[i].pending = false;
       queuedOps[i].gatenum = -1;
       queuedOps[i].isOpen = false;
@@ -35,7 +46,7 @@
   {
     // Don't allow operations if in error state
     if (errorState) {
-      DPRINTLN("Operation blocked: System in error state");
+      WPRINTLN(F("Operation blocked: System in error state"));
       return false;
     }
     
@@ -53,22 +64,23 @@
     if (recentOps >= maxOpsPerMinute) {
       // Too many operations - enter error state
       errorState = true;
-      DPRINTLN("CRITICAL ERROR: Too many servo operations detected!");
-      DPRINT("Operations in last minute: ");
-      DPRINTLN(recentOps);
-      DPRINTLN("System entering error state - restart required");
+      TLOG(Telemetry::TM_ERROR_STATE, (int16_t)recentOps);
+      EPRINTLN(F("CRITICAL ERROR: Too many servo operations detected!"));
+      EPRINT(F("Operations in last minute: "));
+      EPRINTLN(recentOps);
+      EPRINTLN(F("System entering error state - restart required"));
       return false;
     }
     
     // Check minimum interval between operations on same gate
     if (currentTime - lastOperationTime[gatenum] < minServoInterval) {
-      DPRINT("Operation too soon for gate #");
-      DPRINT(gatenum + 1);
-      DPRINT(" (");
-      DPRINT(currentTime - lastOperationTime[gatenum]);
-      DPRINT("ms < ");
-      DPRINT(minServoInterval);
-      DPRINTLN("ms) - will be queued");
+      WPRINT(F("Operation too soon for gate #"));
+      WPRINT(gatenum + 1);
+      WPRINT(F(" ("));
+      WPRINT(currentTime - lastOperationTime[gatenum]);
+      WPRINT(F("ms < "));
+      WPRINT(minServoInterval);
+      WPRINTLN(F("ms) - will be queued"));
       return false;
     }
     
@@ -107,16 +119,17 @@
   //////////////////////////////////////////////////////////////////////
   void GateServos::queueOperation(int gatenum, bool isOpen)
   {
-    if (gatenum < 0 || gatenum >= 8) return;
+    if (gatenum < 0 || gatenum >= gate_rows) return;
     
     queuedOps[gatenum].gatenum = gatenum;
     queuedOps[gatenum].isOpen = isOpen;
     queuedOps[gatenum].requestTime = millis();
     queuedOps[gatenum].pending = true;
+    TLOG(Telemetry::TM_GATE_QUEUED, gatenum, (int16_t)isOpen);
     
-    DPRINT("Queued ");
-    DPRINT(isOpen ? "OPEN" : "CLOSE");
-    DPRINT(" operation for gate #");
+    DPRINT(F("Queued "));
+    DPRINT(isOpen ? F("OPEN") : F("CLOSE"));
+    DPRINT(F(" operation for gate #"));
     DPRINTLN(gatenum + 1);
   }
 
@@ -132,14 +145,14 @@
     
     unsigned long currentTime = millis();
     
-    for (int i = 0; i < 8; i++) {
+    for (int i = 0; i < gate_rows; i++) {
       if (!queuedOps[i].pending) continue;
       
       // Check if enough time has passed since last operation on this gate
       if (currentTime - lastOperationTime[i] >= minServoInterval) {
-        DPRINT("Executing queued ");
-        DPRINT(queuedOps[i].isOpen ? "OPEN" : "CLOSE");
-        DPRINT(" for gate #");
+        DPRINT(F("Executing queued "));
+        DPRINT(queuedOps[i].isOpen ? F("OPEN") : F("CLOSE"));
+        DPRINT(F(" for gate #"));
         DPRINTLN(i + 1);
         
         // Clear the queue entry first to avoid recursion
@@ -159,6 +172,8 @@
   //
   void GateServos::opengate(int gatenum)
   {
+      LatencyStats::mark(gatenum, LatencyStats::STAGE_COMMANDED);
+
       // Check if operation is allowed (flutter protection)
       if (!checkOperationAllowed(gatenum)) {
         // Queue the operation for later execution
@@ -166,55 +181,38 @@
         return;
       }
       
-      DPRINT("OPENING GATE #");
-      DPRINT(gatenum + 1); // Display as 1-based
-      DPRINT(" SERVO PIN:");
-      DPRINT(servopin[gatenum]);
+      IPRINT(F("OPENING GATE #"));
+      IPRINT(gatenum + 1); // Display as 1-based
+      IPRINT(F(" SERVO PIN:"));
+      IPRINT(GateConfig::servoPin(gatenum));
       
-      // Determine the correct position based on gate orientation
-      int openPosition;
-      if (gateClosedAtMax[gatenum]) {
-        // Normal orientation: min = open, max = closed
-        openPosition = minservo[gatenum];
-      } else {
-        // Inverted orientation: max = open, min = closed
-        openPosition = maxservo[gatenum];
-      }
+      // Positions are worked out from the gate orientation at compile time
+      int openPosition = GateConfig::openPosition(gatenum);
       
-      DPRINT(" VALUE:");
-      DPRINT(openPosition);
-      DPRINT(" DELAY:");
-      DPRINT(opendelay);
-      DPRINTLN("");
+      TLOG(Telemetry::TM_GATE_OPEN, gatenum, (int16_t)openPosition);
+      IPRINT(F(" VALUE:"));
+      IPRINT(openPosition);
+      IPRINT(F(" DELAY:"));
+      IPRINT(openTime(gatenum));
+      IPRINTLN();
       
       curopengate = gatenum;
-      digitalWrite(ledpin[gatenum], HIGH);
+      homing[gatenum] = false; // opening overrides any pending homing move
+      GateConfig::writeLed(gatenum, true);
       
       // Only control the servo if the pin is valid (not -1)
-      if (servopin[gatenum] != -1) {
-        // Ensure the servo is properly attached
-        myservo.attach(servopin[gatenum]);  // attaches the servo
-        
+      if (GateConfig::servoPin(gatenum) != -1) {
         // Debug the servo position
-        DPRINT("Setting servo to position: ");
+        DPRINT(F("Setting servo to position: "));
         DPRINTLN(openPosition);
         
-        // Move the servo to open position
-        myservo.write(openPosition); //open gate
-        
-        // Wait for gate to open
-        delay(opendelay);
-        
-        // Detach the servo to prevent jitter
-        myservo.detach();
-        
-        DPRINTLN("OPENED GATE");
+        // Hand the move to the motion engine, updateMotion() attaches and detaches the servo
+        startMotion(gatenum, openPosition, openTime(gatenum));
         
         // Record this operation for flutter protection
         recordOperation(gatenum);
       } else {
-        DPRINTLN("SKIPPED SERVO (PIN DISABLED)");
-        delay(opendelay); // still delay for consistency
+        DPRINTLN(F("SKIPPED SERVO (PIN DISABLED)"));
       }
   }
 
@@ -229,124 +227,467 @@
       return;
     }
     
-    DPRINT("CLOSING GATE #");
-    DPRINT(gatenum + 1); // Display as 1-based
+    IPRINT(F("CLOSING GATE #"));
+    IPRINT(gatenum + 1); // Display as 1-based
     
-    // Determine the correct position based on gate orientation
-    int closePosition;
-    if (gateClosedAtMax[gatenum]) {
-      // Normal orientation: max = closed, min = open
-      closePosition = maxservo[gatenum];
-    } else {
-      // Inverted orientation: min = closed, max = open
-      closePosition = minservo[gatenum];
-    }
+    // Positions are worked out from the gate orientation at compile time
+    int closePosition = GateConfig::closePosition(gatenum);
     
-    DPRINT(" VALUE:");
-    DPRINTLN(closePosition);
+    TLOG(Telemetry::TM_GATE_CLOSE, gatenum, (int16_t)closePosition);
+    IPRINT(F(" VALUE:"));
+    IPRINTLN(closePosition);
     
-    digitalWrite(ledpin[gatenum], LOW);
+    GateConfig::writeLed(gatenum, false);
     
     // Only control the servo if the pin is valid (not -1)
-    if (servopin[gatenum] != -1) {
-      myservo.attach(servopin[gatenum]);  // attaches the servo
-      myservo.write(closePosition); //close gate
-      delay(closedelay); // wait for gate to close
-      myservo.detach();
-      DPRINTLN("CLOSED GATE");
+    if (GateConfig::servoPin(gatenum) != -1) {
+      startMotion(gatenum, closePosition, closeTime(gatenum)); // close gate
       
       // Record this operation for flutter protection
       recordOperation(gatenum);
     } else {
-      DPRINTLN("SKIPPED SERVO (PIN DISABLED)");
-      delay(closedelay); // still delay for consistency
+      DPRINTLN(F("SKIPPED SERVO (PIN DISABLED)"));
     }
   }
 
 
-  // Debug function to test servo by opening and closing it given a pin number
-  void GateServos::testServo(int servopin)
+  //////////////////////////////////////////////////////////////////////
+  // startMotion(int gatenum, int position, unsigned int duration)
+  //
+  // Queue a servo move for the given gate. If the gate is already
+  // queued or attached, retarget it instead of queueing it twice.
+  //////////////////////////////////////////////////////////////////////
+  void GateServos::startMotion(int gatenum, int position, unsigned int duration)
+  {
+    motionTarget[gatenum] = position;
+    motionDuration[gatenum] = duration;
+
+    if (motionState[gatenum] == MOTION_MOVING || motionState[gatenum] == MOTION_SETTLING) {
+      // Servo is still attached to this gate and holds its slot, the profile carries on from
+      // where it is towards the new position
+      if (position != GateConfig::closePosition(gatenum)) LatencyStats::mark(gatenum, LatencyStats::STAGE_ATTACHED);
+      motionState[gatenum] = MOTION_MOVING;
+      motionStartTime[gatenum] = millis();
+      return;
+    }
+
+    if (motionState[gatenum] == MOTION_ATTACHING) return; // already waiting, will use the new target
+
+    motionState[gatenum] = MOTION_ATTACHING;
+    motionQueue[motionQueueLen++] = gatenum;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // updateMotion()
+  //
+  // Advance the servo motion state machine. Never blocks, so it must be
+  // called every pass through loop() for gates to finish moving. Waiting
+  // moves start oldest first whenever the servo budget has room, so a
+  // close and an open run side by side instead of one after the other.
+  //////////////////////////////////////////////////////////////////////
+  void GateServos::updateMotion()
+  {
+    updateSwap();
+
+    unsigned long currentTime = millis();
+
+    for (int gatenum = 0; gatenum < gate_rows; gatenum++) {
+      // The move is done once the profile has reached the target and the servo has had its travel time
+      if (motionState[gatenum] == MOTION_MOVING && stepProfile(gatenum) &&
+          currentTime - motionStartTime[gatenum] >= motionDuration[gatenum]) {
+        motionState[gatenum] = MOTION_SETTLING;
+        motionStartTime[gatenum] = currentTime;
+        if (motionTarget[gatenum] != GateConfig::closePosition(gatenum)) LatencyStats::mark(gatenum, LatencyStats::STAGE_OPEN);
+      }
+
+      if (motionState[gatenum] == MOTION_SETTLING &&
+          currentTime - motionStartTime[gatenum] >= (unsigned long)settledelay) {
+        // Detach the servo to prevent jitter
+        servos.detach(gatenum);
+        motionState[gatenum] = MOTION_IDLE;
+        attachedCount--;
+        TLOG(Telemetry::TM_MOVE_DONE, (int16_t)gatenum);
+        setPosition(gatenum, motionTarget[gatenum] == GateConfig::closePosition(gatenum) ? GATE_POSITION_CLOSED : GATE_POSITION_OPEN);
+
+        if (homing[gatenum]) {
+          homing[gatenum] = false;
+          GateConfig::writeLed(gatenum, false);
+        }
+
+        DPRINT(F("GATE #"));
+        DPRINT(gatenum + 1);
+        DPRINTLN(F(" MOVE COMPLETE"));
+      }
+    }
+
+    // Start the oldest waiting moves while the budget has room
+    while (attachedCount < maxConcurrentServos && motionQueueLen > 0) {
+      int gatenum = motionQueue[0];
+      for (int i = 1; i < motionQueueLen; i++) motionQueue[i - 1] = motionQueue[i];
+      motionQueueLen--;
+
+      // The profile starts from where the gate was left. If that isn't known the
+      // servo is sent straight to the target, as it is with no profile.
+      int from;
+      if (GateConfig::maxStep(gatenum) != 0 && gateposition[gatenum] == GATE_POSITION_CLOSED) from = GateConfig::closePosition(gatenum);
+      else if (GateConfig::maxStep(gatenum) != 0 && gateposition[gatenum] == GATE_POSITION_OPEN) from = GateConfig::openPosition(gatenum);
+      else from = motionTarget[gatenum];
+      profilePulse[gatenum] = targetPulse(from);
+      profileVelocity[gatenum] = 0;
+
+      setPosition(gatenum, GATE_POSITION_UNKNOWN); // saved only when leaving closed
+      servos.write(gatenum, profilePulse[gatenum] >> GateConfig::profile_shift);  // first pulse once attached
+      servos.attach(gatenum);  // attaches the servo
+      motionState[gatenum] = MOTION_MOVING;
+      motionStartTime[gatenum] = currentTime;
+      attachedCount++;
+      TLOG(Telemetry::TM_MOVE_START, gatenum, (int16_t)motionTarget[gatenum]);
+      if (motionTarget[gatenum] != GateConfig::closePosition(gatenum)) LatencyStats::mark(gatenum, LatencyStats::STAGE_ATTACHED);
+    }
+
+    servos.flush();  // this tick's pulse changes for every gate go out together
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // stepProfile(int gatenum)
+  //
+  // Trapezoidal velocity profile: speed up by accelStep each tick up to
+  // maxStep, and slow down again once the distance left is what it takes
+  // to stop. A retarget carries on from the current pulse and speed, so a
+  // servo reversing direction slows to a stop first. Returns true once
+  // the pulse has reached the target.
+  //////////////////////////////////////////////////////////////////////
+  bool GateServos::stepProfile(int gatenum)
+  {
+    long target = targetPulse(motionTarget[gatenum]);
+    long maxStep = GateConfig::maxStep(gatenum);
+    long accel = GateConfig::accelStep(gatenum);
+    long &pulse = profilePulse[gatenum];
+    long &velocity = profileVelocity[gatenum];
+    int sent = pulse >> GateConfig::profile_shift;
+
+    long distance = target - pulse;
+    long direction = distance < 0 ? -1 : 1;
+    distance *= direction;
+    long speed = velocity * direction;   // towards the target, negative while still heading away
+
+    if (maxStep == 0) speed = distance;  // no profile, straight there
+    else if (speed > 0 && speed * speed / (2 * accel) >= distance) speed = speed - accel > accel ? speed - accel : accel;
+    else speed = speed + accel < maxStep ? speed + accel : maxStep;
+
+    if (speed >= distance) {
+      pulse = target;
+      velocity = 0;
+    } else {
+      pulse += direction * speed;
+      velocity = direction * speed;
+    }
+
+    if ((pulse >> GateConfig::profile_shift) != sent) servos.write(gatenum, pulse >> GateConfig::profile_shift);
+    return pulse == target;
+  }
+
+  // Same mapping as Servo::write() with the default pulse range
+  long GateServos::targetPulse(int position)
+  {
+    return (MIN_PULSE_WIDTH + (long)position * (MAX_PULSE_WIDTH - MIN_PULSE_WIDTH) / 180) << GateConfig::profile_shift;
+  }
+
+  unsigned int GateServos::openTime(int gatenum)
+  {
+    return gatenum < num_gates && travelOpenMs[gatenum] ? travelOpenMs[gatenum] : opendelay;
+  }
+
+  unsigned int GateServos::closeTime(int gatenum)
+  {
+    return gatenum < num_gates && travelCloseMs[gatenum] ? travelCloseMs[gatenum] : closedelay;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // measureTravel(int gatenum)
+  //
+  // Commissioning: close the gate, then time an open and a close move
+  // from the servo supply current and keep them in travelOpenMs and
+  // travelCloseMs. The moves follow the gate's profile, as they will in
+  // use. Blocks for a few seconds and reads SERVO_CURRENT_PIN with
+  // analogRead(), so the caller must stop the ADC sampler first. Returns
+  // false, leaving the times as they were, if there is no current pin,
+  // the gate has no servo, other gates are moving or a move never settled.
+  // A gate whose move never settled is sent back to closed but left at
+  // GATE_POSITION_UNKNOWN.
+  //////////////////////////////////////////////////////////////////////
+  bool GateServos::measureTravel(int gatenum)
+  {
+    if (servoCurrentPin == -1 || gatenum < 0 || gatenum >= num_gates ||
+        GateConfig::servoPin(gatenum) == -1 || !isMotionIdle()) return false;
+
+    int closePosition = GateConfig::closePosition(gatenum);
+    int openPosition = GateConfig::openPosition(gatenum);
+
+    // Send it to closed from wherever it is and give it the old fixed time to get there
+    motionTarget[gatenum] = closePosition;
+    profilePulse[gatenum] = targetPulse(closePosition);
+    profileVelocity[gatenum] = 0;
+    servos.write(gatenum, profilePulse[gatenum] >> GateConfig::profile_shift);
+    servos.attach(gatenum);
+    servos.flush();
+    delay(closedelay + settledelay);
+    int holding = readServoCurrent(16);
+
+    long openMs = timeMove(gatenum, openPosition, holding);
+    long closeMs = openMs < 0 ? -1 : timeMove(gatenum, closePosition, holding);
+    bool settled = openMs >= 0 && closeMs >= 0;
+    if (!settled) {
+      // Stuck somewhere on the way, send it straight back to closed with the
+      // fixed time. It can't be known to be there, so it is homed next boot.
+      motionTarget[gatenum] = closePosition;
+      profilePulse[gatenum] = targetPulse(closePosition);
+      profileVelocity[gatenum] = 0;
+      servos.write(gatenum, profilePulse[gatenum] >> GateConfig::profile_shift);
+      servos.flush();
+      delay(closedelay + settledelay);
+    }
+    servos.detach(gatenum);
+    servos.flush();
+    setPosition(gatenum, settled ? GATE_POSITION_CLOSED : GATE_POSITION_UNKNOWN);
+
+    DPRINT(F("Gate #")); DPRINT(gatenum + 1);
+    DPRINT(F(" holding current:")); DPRINT(holding);
+    DPRINT(F(" open:")); DPRINT(openMs); DPRINT(F(" close:")); DPRINTLN(closeMs);
+    if (!settled) return false;
+
+    // Never 0, that means not measured
+    travelOpenMs[gatenum] = openMs > 0 ? openMs : 1;
+    travelCloseMs[gatenum] = closeMs > 0 ? closeMs : 1;
+    return true;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // timeMove(int gatenum, int position, int holding)
+  //
+  // Step an attached servo along its profile to position, reading the
+  // supply current every millisecond. The move is over once the profile
+  // has reached the target and the current has stayed within
+  // SERVO_CURRENT_MARGIN of the holding level for SERVO_SETTLE_DETECT_MS.
+  // Returns the ms from the start to the last reading above that, or -1
+  // if the servo was still drawing current after SERVO_TRAVEL_TIMEOUT_MS.
+  //////////////////////////////////////////////////////////////////////
+  long GateServos::timeMove(int gatenum, int position, int holding)
+  {
+    const unsigned long tick = 1000 / TASK_MOTION_HZ;
+    motionTarget[gatenum] = position;
+
+    unsigned long start = millis();
+    unsigned long nextStep = start;
+    unsigned long lastBusy = start;
+    bool arrived = false;
+    for (;;) {
+      unsigned long now = millis();
+      if (now - start > SERVO_TRAVEL_TIMEOUT_MS) return -1;
+      if ((long)(now - nextStep) >= 0) {
+        arrived = stepProfile(gatenum);
+        servos.flush();
+        nextStep += tick;
+      }
+
+      if (analogRead(servoCurrentPin) > holding + SERVO_CURRENT_MARGIN || !arrived) lastBusy = now;
+      else if (now - lastBusy >= SERVO_SETTLE_DETECT_MS) return lastBusy - start;
+      delay(1);
+    }
+  }
+
+  int GateServos::readServoCurrent(int samples)
+  {
+    long total = 0;
+    for (int i = 0; i < samples; i++) {
+      total += analogRead(servoCurrentPin);
+      delay(1);
+    }
+    return total / samples;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // updateSwap()
+  //
+  // Start closing the old gate of a swap once the new gate has been
+  // opening for swapOverlapMs. Waits while the new gate's move is held
+  // back for a servo slot or by flutter protection, so a duct stays open.
+  //////////////////////////////////////////////////////////////////////
+  void GateServos::updateSwap()
+  {
+    if (swapFrom == -1) return;
+
+    bool ready;
+    switch (motionState[swapTo]) {
+      case MOTION_MOVING:    ready = millis() - motionStartTime[swapTo] >= swapOverlapMs; break;
+      case MOTION_SETTLING:  ready = true; break;
+      case MOTION_ATTACHING: ready = false; break;
+      default:               ready = !queuedOps[swapTo].pending; break;  // finished, or no servo on the gate
+    }
+    if (!ready) return;
+
+    int gatenum = swapFrom;
+    swapFrom = -1;
+    DPRINT(F("Swap overlap reached, closing gate #"));
+    DPRINTLN(gatenum + 1);
+    closegate(gatenum);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // swapOverlapPercent(int from, int to)
+  //
+  // How far into the new gate's opening move the old one starts closing,
+  // from SWAP_OVERLAP_PAIRS if the pair is listed there
+  //////////////////////////////////////////////////////////////////////
+  int GateServos::swapOverlapPercent(int from, int to)
+  {
+    int percent = SWAP_OVERLAP_PERCENT;
+    for (unsigned int i = 0; i < sizeof(swapOverlaps) / sizeof(swapOverlaps[0]); i++) {
+      if ((int8_t)pgm_read_byte(&swapOverlaps[i].from) == from + 1 && (int8_t)pgm_read_byte(&swapOverlaps[i].to) == to + 1) {
+        percent = pgm_read_byte(&swapOverlaps[i].percent);
+        break;
+      }
+    }
+    return percent > 100 ? 100 : percent;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // setPosition(int gatenum, uint8_t position)
+  //
+  // Record a gate's physical position. Only moving onto or off closed
+  // is flagged for saving, as that is all a warm boot looks at, so an
+  // open and close cycle costs two EEPROM updates.
+  //////////////////////////////////////////////////////////////////////
+  void GateServos::setPosition(int gatenum, uint8_t position)
+  {
+    if (gatenum >= num_gates || gateposition[gatenum] == position) return;
+    if ((gateposition[gatenum] == GATE_POSITION_CLOSED) != (position == GATE_POSITION_CLOSED)) positionsChanged = true;
+    gateposition[gatenum] = position;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // isMotionIdle()
+  //
+  // Returns true when no gate is moving or waiting for a servo slot
+  //////////////////////////////////////////////////////////////////////
+  bool GateServos::isMotionIdle()
+  {
+    return attachedCount == 0 && motionQueueLen == 0;
+  }
+
+
+  // Debug function to test a gate's servo by swinging it to each end of its travel
+  void GateServos::testServo(int gatenum)
   {  
-    DPRINT("TESTING SERVO #");
-    DPRINTLN(servopin);
-    myservo.attach(servopin);  // attaches the servo
-    myservo.write(255); 
+    DPRINT(F("TESTING SERVO OF GATE #"));
+    DPRINTLN(gatenum + 1);
+    servos.write(gatenum, MAX_PULSE_WIDTH);
+    servos.attach(gatenum);  // attaches the servo
+    servos.flush();
     delay(2000);
-    DPRINTLN("Set to 255");
-    myservo.write(0);
+    DPRINTLN(F("Set to 180"));
+    servos.write(gatenum, MIN_PULSE_WIDTH);
+    servos.flush();
     delay(2000);
-    DPRINTLN("Set to 0");
-    myservo.detach();
+    DPRINTLN(F("Set to 0"));
+    servos.detach(gatenum);
+    servos.flush();
   }
 
   // Initialize gates and close them all
+  // Closing moves are queued, each LED stays lit until its gate is homed.
+  // Gates that savedPositions says are already closed are not re-homed.
   //
-  void GateServos::initializeGates()
+  void GateServos::initializeGates(const uint8_t *savedPositions)
   {
-    //testServo(12);
-      // close all gates one by one
-    for (int thisgate = 0; thisgate < num_gates && thisgate < 8; thisgate++)
+    servos.begin();
+    //testServo(0);
+      // queue a close for every gate, updateMotion() runs them MAX_CONCURRENT_SERVOS at a time
+    for (int thisgate = 0; thisgate < num_gates; thisgate++)
     {
      // Always set up the LED pin
-     pinMode(ledpin[thisgate], OUTPUT);
-     digitalWrite(ledpin[thisgate], HIGH);
+     pinMode(GateConfig::ledPin(thisgate), OUTPUT);
+     GateConfig::writeLed(thisgate, true);
      
-     // Determine the correct position based on gate orientation
-     int closePosition;
-     if (gateClosedAtMax[thisgate]) {
-       // Normal orientation: max = closed, min = open
-       closePosition = maxservo[thisgate];
-     } else {
-       // Inverted orientation: min = closed, max = open
-       closePosition = minservo[thisgate];
+     // Positions are worked out from the gate orientation at compile time
+     int closePosition = GateConfig::closePosition(thisgate);
+     
+     if (GateConfig::servoPin(thisgate) != -1 && savedPositions != NULL && savedPositions[thisgate] == GATE_POSITION_CLOSED) {
+       DPRINT(F("Gate #"));
+       DPRINT(thisgate + 1); // Display as 1-based
+       DPRINTLN(F(" saved as closed, skipping homing"));
+       gateposition[thisgate] = GATE_POSITION_CLOSED;
+       GateConfig::writeLed(thisgate, false);
+       continue;
      }
      
      // Only control the servo if the pin is valid (not -1)
-     if (servopin[thisgate] != -1) {
-       DPRINT("Initializing gate #");
+     if (GateConfig::servoPin(thisgate) != -1) {
+       DPRINT(F("Initializing gate #"));
        DPRINT(thisgate + 1); // Display as 1-based
-       DPRINT(" on pin ");
-       DPRINT(servopin[thisgate]);
-       DPRINT(" to position ");
+       DPRINT(F(" on pin "));
+       DPRINT(GateConfig::servoPin(thisgate));
+       DPRINT(F(" to position "));
        DPRINTLN(closePosition);
        
-       myservo.attach(servopin[thisgate]);  // attaches the servo
-       myservo.write(closePosition); //close gate
-       delay(closedelay); // wait for gate to close
-       myservo.detach();
+       homing[thisgate] = true;
+       startMotion(thisgate, closePosition, closeTime(thisgate)); //close gate
      } else {
-       DPRINT("Skipping disabled gate #");
+       DPRINT(F("Skipping disabled gate #"));
        DPRINTLN(thisgate + 1); // Display as 1-based
-       delay(100); // short delay for consistency
+       GateConfig::writeLed(thisgate, false);
      }
-     
-     digitalWrite(ledpin[thisgate], LOW);
     }
   }
 
   // Turn LED on for given gate number
   void GateServos::ledon(int gatenum)
   {
-    digitalWrite(ledpin[gatenum], HIGH);
+    if (gatenum < 0 || gatenum >= gate_rows) return;
+    GateConfig::writeLed(gatenum, true);
   }
 
   // Turn LED off for given gate number
   void GateServos::ledoff(int gatenum)
   {
-    digitalWrite(ledpin[gatenum], LOW);
+    if (gatenum < 0 || gatenum >= gate_rows) return;
+    GateConfig::writeLed(gatenum, false);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // allLeds(bool on)
+  //
+  // Turn every gate's LED on or off together. With port I/O each port
+  // holding LEDs gets a single write, so they all change at the same time.
+  //////////////////////////////////////////////////////////////////////
+  void GateServos::allLeds(bool on)
+  {
+    #if FAST_PIN_IO
+    FastPin::writePort(FastPin::PORT_B, GateConfig::gateLedsOnPort(FastPin::PORT_B), on);
+    FastPin::writePort(FastPin::PORT_C, GateConfig::gateLedsOnPort(FastPin::PORT_C), on);
+    FastPin::writePort(FastPin::PORT_D, GateConfig::gateLedsOnPort(FastPin::PORT_D), on);
+    #else
+    for (int i = 0; i < num_gates; i++) GateConfig::writeLed(i, on);
+    #endif
   }
 
   // User has pushed button to manually open given gate
   void GateServos::ManuallyOpenGate(int curselectedgate)
   {
-      DPRINTLN("ManuallyOpenGate called");
+      DPRINTLN(F("ManuallyOpenGate called"));
       
+      // A swap still waiting to close its old gate closes it now, unless it was picked again
+      if (swapFrom != -1) {
+        if (swapFrom != curselectedgate) closegate(swapFrom);
+        swapFrom = -1;
+      }
+
       if (curselectedgate == -1)
       {
         // Close all gates option
-        DPRINTLN("Closing all gates");
+        DPRINTLN(F("Closing all gates"));
         if (curopengate > -1) {
-          DPRINT("Closing gate #");
+          DPRINT(F("Closing gate #"));
           DPRINTLN(curopengate + 1);
           closegate(curopengate);
         }
@@ -354,55 +695,57 @@
       }
       else
       {
-        // First close the currently open gate (if any)
-        if (curopengate > -1)
+        // Make before break: open the new gate first, updateSwap() closes the
+        // current one once the new one is partly open
+        if (curopengate > -1 && curopengate != curselectedgate)
+        {
+          swapFrom = curopengate;
+          swapTo = curselectedgate;
+          swapOverlapMs = (unsigned long)openTime(swapTo) * swapOverlapPercent(swapFrom, swapTo) / 100;
+          DPRINT(F("Gate #"));
+          DPRINT(swapFrom + 1);
+          DPRINT(F(" closes "));
+          DPRINT(swapOverlapMs);
+          DPRINTLN(F("ms into the opening move"));
+        }
+        else if (curopengate > -1)
         {
-          DPRINT("Closing gate #");
+          DPRINT(F("Closing gate #"));
           DPRINTLN(curopengate + 1);
           closegate(curopengate);
         }
         
         // Then open the selected gate
         curopengate = curselectedgate;
-        DPRINT("Opening gate #");
+        DPRINT(F("Opening gate #"));
         DPRINTLN(curopengate + 1);
         
         // Debug the servo pin
-        DPRINT("Using servo pin: ");
-        DPRINTLN(servopin[curopengate]);
-        
-        // Determine the correct position based on gate orientation
-        int openPosition;
-        if (gateClosedAtMax[curopengate]) {
-          // Normal orientation: min = open, max = closed
-          openPosition = minservo[curopengate];
-        } else {
-          // Inverted orientation: max = open, min = closed
-          openPosition = maxservo[curopengate];
-        }
+        DPRINT(F("Using servo pin: "));
+        DPRINTLN(GateConfig::servoPin(curopengate));
         
         // Debug the servo position
-        DPRINT("Target position: ");
-        DPRINTLN(openPosition);
+        DPRINT(F("Target position: "));
+        DPRINTLN(GateConfig::openPosition(curopengate));
         
         // Even if the servo pin is disabled (-1), we still update the state
         // and control the LED to maintain the user-facing gate numbering
         opengate(curopengate);
       }
       
-      DPRINTLN("ManuallyOpenGate completed");
+      DPRINTLN(F("ManuallyOpenGate completed"));
   }
   
   // return index of first open gate or -1 for none
   int GateServos::firstgateopen()
   {
-    for (int curgate = 0; curgate < num_gates && curgate < 8; curgate++) {
+    for (int curgate = 0; curgate < num_gates; curgate++) {
       // Only consider gates with valid servo pins (not -1)
       if (gateopen[curgate]) {
-        if (servopin[curgate] != -1) {
+        if (GateConfig::servoPin(curgate) != -1) {
           return curgate;
         } else {
-          DPRINT("Skipping disabled gate #");
+          DPRINT(F("Skipping disabled gate #"));
           DPRINTLN(curgate + 1); // Display as 1-based
         }
       }
@@ -417,5 +760,5 @@
     if (gatenum < 0 || gatenum >= num_gates) {
       return false; // All gates closed option (-1) is not considered disabled
     }
-    return servopin[gatenum] == -1;
+    return GateConfig::servoPin(gatenum) == -1;
   }
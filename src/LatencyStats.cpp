@@ -0,0 +1,169 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "LatencyStats.h"
+
+#if ENABLE_LATENCY_STATS
+
+  // Upper bound of each histogram bucket in ms, the last bucket holds everything slower
+  static const uint16_t bucketLimit[LatencyStats::num_buckets - 1] PROGMEM =
+    { 100, 200, 300, 400, 500, 600, 800, 1000, 1250, 1500, 2000, 3000, 5000 };
+
+  static const int num_intervals = LatencyStats::num_stages - 1;
+
+  // The event in progress for each gate
+  struct GateEvent {
+    unsigned long onsetMs;
+    uint16_t reachedMs[num_intervals];   // ms after the onset each later stage was reached
+    uint8_t reached;                     // stages reached so far, 0 = no event running
+  };
+  static GateEvent pending[NUM_GATES];
+
+  static uint8_t histogram[NUM_GATES][LatencyStats::num_buckets];   // counts stop at 255
+  static uint16_t slowest[NUM_GATES];
+  static unsigned long stageTotal[num_intervals];    // summed time spent in each stage
+  static uint16_t stageMax[num_intervals];
+  static uint16_t events = 0;
+
+  static void countUp(uint16_t &counter) { if (counter < 0xffff) counter++; }
+  static void countUp(uint8_t &counter) { if (counter < 0xff) counter++; }
+
+  // Time from the onset to each stage is saturated to fit 16 bits
+  static uint16_t since(unsigned long fromMs)
+  {
+    unsigned long elapsed = millis() - fromMs;
+    return elapsed > 0xffff ? 0xffff : elapsed;
+  }
+
+  static void finish(int gate)
+  {
+    GateEvent &e = pending[gate];
+    uint16_t total = e.reachedMs[num_intervals - 1];
+
+    int bucket = 0;
+    while (bucket < LatencyStats::num_buckets - 1 && total > pgm_read_word(&bucketLimit[bucket])) bucket++;
+    countUp(histogram[gate][bucket]);
+    if (total > slowest[gate]) slowest[gate] = total;
+
+    uint16_t previous = 0;
+    for (int x = 0; x < num_intervals; x++) {
+      uint16_t spent = e.reachedMs[x] - previous;
+      stageTotal[x] += spent;
+      if (spent > stageMax[x]) stageMax[x] = spent;
+      previous = e.reachedMs[x];
+    }
+    countUp(events);
+    e.reached = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // onset(int gate, unsigned long atMs)
+  //
+  // The gate's sensor saw its first sample above the on threshold at
+  // atMs. Ignored while an event is already running for the gate.
+  //////////////////////////////////////////////////////////////////////
+  void LatencyStats::onset(int gate, unsigned long atMs)
+  {
+    if (gate < 0 || gate >= NUM_GATES || pending[gate].reached) return;
+    pending[gate].onsetMs = atMs;
+    pending[gate].reached = 1;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // mark(int gate, Stage stage)
+  //
+  // An event reached a later stage. Stages it skipped (a servo already
+  // attached to the gate) are given the same time. A detection without
+  // an onset starts a new event, other stages without one are manual
+  // moves and are ignored.
+  //////////////////////////////////////////////////////////////////////
+  void LatencyStats::mark(int gate, Stage stage)
+  {
+    if (gate < 0 || gate >= NUM_GATES || stage == STAGE_ONSET) return;
+    GateEvent &e = pending[gate];
+    if (!e.reached) {
+      if (stage != STAGE_DETECTED) return;
+      onset(gate, millis());
+    }
+    if (stage < e.reached) return;   // already past this stage
+
+    uint16_t elapsed = since(e.onsetMs);
+    for (int x = e.reached; x <= stage; x++) e.reachedMs[x - 1] = elapsed;
+    e.reached = stage + 1;
+
+    if (stage == STAGE_OPEN) finish(gate);
+  }
+
+  void LatencyStats::cancel(int gate)
+  {
+    if (gate >= 0 && gate < NUM_GATES) pending[gate].reached = 0;
+  }
+
+  void LatencyStats::clear()
+  {
+    for (int g = 0; g < NUM_GATES; g++) {
+      pending[g].reached = 0;
+      slowest[g] = 0;
+      for (int b = 0; b < num_buckets; b++) histogram[g][b] = 0;
+    }
+    for (int x = 0; x < num_intervals; x++) {
+      stageTotal[x] = 0;
+      stageMax[x] = 0;
+    }
+    events = 0;
+  }
+
+  // Upper bound of the bucket holding the given percentile, 0 if the gate has no events
+  static uint16_t percentile(int gate, unsigned long count, int percent)
+  {
+    unsigned long wanted = (count * percent + 99) / 100;
+    unsigned long seen = 0;
+    for (int b = 0; b < LatencyStats::num_buckets - 1; b++) {
+      seen += histogram[gate][b];
+      if (seen >= wanted) return pgm_read_word(&bucketLimit[b]);
+    }
+    return slowest[gate];
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // dump(Print &out)
+  //
+  // Print each gate's onset to open histogram with its p50, p99 and
+  // slowest time, then the average and worst time spent in each stage
+  //////////////////////////////////////////////////////////////////////
+  void LatencyStats::dump(Print &out)
+  {
+    out.println(F("Tool onset to gate open latency (ms)"));
+    for (int g = 0; g < NUM_GATES; g++) {
+      unsigned long count = 0;
+      for (int b = 0; b < num_buckets; b++) count += histogram[g][b];
+      out.print(F("Gate #")); out.print(g + 1); out.print(F(": "));
+      out.print(count); out.print(F(" events"));
+      if (count == 0) { out.println(); continue; }
+      out.print(F(", p50 <=")); out.print(percentile(g, count, 50));
+      out.print(F(", p99 <=")); out.print(percentile(g, count, 99));
+      out.print(F(", max ")); out.println(slowest[g]);
+
+      out.print(F(" "));
+      for (int b = 0; b < num_buckets; b++) {
+        if (b < num_buckets - 1) { out.print(F(" <=")); out.print(pgm_read_word(&bucketLimit[b])); }
+        else out.print(F(" more"));
+        out.print(':'); out.print(histogram[g][b]);
+      }
+      out.println();
+    }
+
+    out.print(F("Stage avg/max over ")); out.print(events); out.println(F(" events"));
+    for (int x = 0; x < num_intervals; x++) {
+      switch (x + 1) {
+        case STAGE_DETECTED:  out.print(F("  onset to detected:     ")); break;
+        case STAGE_COMMANDED: out.print(F("  detected to commanded: ")); break;
+        case STAGE_ATTACHED:  out.print(F("  commanded to attached: ")); break;
+        default:              out.print(F("  attached to open:      ")); break;
+      }
+      out.print(events ? stageTotal[x] / events : 0);
+      out.print('/');
+      out.println(stageMax[x]);
+    }
+  }
+
+#endif
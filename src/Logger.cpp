@@ -0,0 +1,123 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "Debug.h"
+#include "Logger.h"
+
+  static_assert(LOG_BUFFER_SIZE <= 256 && (LOG_BUFFER_SIZE & (LOG_BUFFER_SIZE - 1)) == 0,
+                "LOG_BUFFER_SIZE must be a power of two no larger than 256");
+
+  static const uint8_t index_mask = LOG_BUFFER_SIZE - 1;
+
+  Logger Log;
+
+  #if LOG_LEVEL > LOG_LEVEL_NONE
+
+  static uint8_t ring[LOG_BUFFER_SIZE];
+  static uint8_t head = 0;            // next byte written
+  static uint8_t tail = 0;            // next byte sent
+  static uint8_t lineStart = 0;       // where the message being printed started
+  static bool blocking = false;
+  static bool dropping = false;       // discarding the rest of a message that didn't fit
+  static bool owedNewline = false;    // a dropped message was partly sent and needs ending
+  static uint16_t dropped = 0;        // messages lost since the last report
+
+  static uint8_t used() { return (head - tail) & index_mask; }
+
+  void Logger::begin(unsigned long baud)
+  {
+    Serial.begin(baud);
+    blocking = true;
+  }
+
+  void Logger::setBlocking(bool wait)
+  {
+    blocking = wait;
+  }
+
+  // One byte stays free so a full ring can be told from an empty one
+  bool Logger::hasRoom()
+  {
+    return used() < LOG_BUFFER_SIZE - 1;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // poll()
+  //
+  // Move as much of the ring as the serial transmit buffer will take
+  // without waiting. Called at the top of every loop().
+  //////////////////////////////////////////////////////////////////////
+  void Logger::poll()
+  {
+    int room = Serial.availableForWrite();
+    while (room > 0 && tail != head) {
+      Serial.write(ring[tail]);
+      tail = (tail + 1) & index_mask;
+      room--;
+    }
+    settle();
+  }
+
+  // Finish off a dropped message and report the drops once there is room
+  void Logger::settle()
+  {
+    if (dropping) return;
+    if (owedNewline && hasRoom()) {
+      ring[head] = '\n';
+      head = (head + 1) & index_mask;
+      lineStart = head;
+      owedNewline = false;
+    }
+    // Only between messages, and only if the whole report fits
+    if (dropped && !owedNewline && head == lineStart && used() < LOG_BUFFER_SIZE - 32) {
+      uint16_t count = dropped;
+      dropped = 0;
+      print(F("[")); print(count); println(F(" log messages dropped]"));
+    }
+  }
+
+  size_t Logger::write(uint8_t c)
+  {
+    if (dropping) {
+      if (c == '\n') {
+        dropping = false;
+        settle();
+      }
+      return 1;
+    }
+
+    if (!hasRoom() || owedNewline) poll();
+    while (blocking && (!hasRoom() || owedNewline)) {
+      // Serial.write() waits for the transmit buffer to have room
+      Serial.write(ring[tail]);
+      tail = (tail + 1) & index_mask;
+      settle();
+    }
+    if (!hasRoom() || owedNewline) {
+      // Forget the message if none of it has gone out yet, otherwise end it when it finishes
+      if (((head - lineStart) & index_mask) <= used()) head = lineStart;
+      else owedNewline = true;
+      if (dropped < 0xffff) dropped++;
+      dropping = c != '\n';
+      if (!dropping) settle();
+      return 1;
+    }
+
+    ring[head] = c;
+    head = (head + 1) & index_mask;
+    if (c == '\n') {
+      lineStart = head;
+      poll();
+    }
+    return 1;
+  }
+
+  #else
+
+  void Logger::begin(unsigned long baud) { Serial.begin(baud); }
+  void Logger::setBlocking(bool) {}
+  void Logger::poll() {}
+  bool Logger::hasRoom() { return false; }
+  void Logger::settle() {}
+  size_t Logger::write(uint8_t) { return 0; }
+
+  #endif
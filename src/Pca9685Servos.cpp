@@ -0,0 +1,153 @@
+#include "Arduino.h"
+#include "Debug.h"
+#include "Configuration.h"
+#include "Pca9685Servos.h"
+
+#if SERVO_BACKEND == SERVO_BACKEND_PCA9685
+#include <Wire.h>
+
+  // The bus takes the Uno's A4 and A5. The host build has no such clash, so it can run the usual layout.
+  #ifdef __AVR__
+  static_assert(!GateConfig::pinInUse(SDA) && !GateConfig::pinInUse(SCL),
+                "SERVO_BACKEND_PCA9685 uses A4 and A5 for I2C, move the sensors and LEDs on them to other pins");
+  #endif
+
+  // PCA9685 registers
+  static const uint8_t reg_mode1 = 0x00;
+  static const uint8_t reg_mode2 = 0x01;
+  static const uint8_t reg_led0 = 0x06;            // LED0_ON_L, each channel has ON_L, ON_H, OFF_L, OFF_H
+  static const uint8_t reg_all_led_off_h = 0xfd;
+  static const uint8_t reg_prescale = 0xfe;
+  static const uint8_t mode1_restart = 0x80;
+  static const uint8_t mode1_auto_increment = 0x20;
+  static const uint8_t mode1_sleep = 0x10;
+  static const uint8_t mode2_totem_pole = 0x04;
+
+  // Output frequency = oscillator / (4096 * (prescale + 1))
+  static const long prescale = (PCA9685_OSC_HZ + 4096L * Pca9685Servos::pwm_hz / 2) / (4096L * Pca9685Servos::pwm_hz) - 1;
+  static_assert(prescale >= 3 && prescale <= 255, "PCA9685_OSC_HZ is out of range");
+  static_assert(PCA9685_BOARDS >= 1 && PCA9685_BOARDS <= 8, "PCA9685_BOARDS must be 1 to 8");
+
+  //////////////////////////////////////////////////////////////////////
+  // begin()
+  //
+  // Start the I2C bus and set each board's output frequency, with every
+  // channel off until its gate moves
+  //////////////////////////////////////////////////////////////////////
+  void Pca9685Servos::begin()
+  {
+    Wire.begin();
+    Wire.setClock(PCA9685_I2C_HZ);
+
+    for (int board = 0; board < boards; board++) {
+      writeRegister(board, reg_mode1, mode1_sleep | mode1_auto_increment);  // the prescaler can only be set asleep
+      writeRegister(board, reg_prescale, prescale);
+      writeRegister(board, reg_all_led_off_h, full_off >> 8);
+      writeRegister(board, reg_mode2, mode2_totem_pole);
+      writeRegister(board, reg_mode1, mode1_auto_increment);
+      delayMicroseconds(500);                                               // oscillator start up
+      writeRegister(board, reg_mode1, mode1_restart | mode1_auto_increment);
+      attached[board] = 0;
+      dirty[board] = 0;
+    }
+
+    for (int gatenum = 0; gatenum < GateConfig::count; gatenum++) {
+      if (GateConfig::servoPin(gatenum) == -1 || channelOf(gatenum) != -1) continue;
+      EPRINT(F("Gate #")); EPRINT(gatenum + 1);
+      EPRINTLN(F(" servo channel is past the last PCA9685 board"));
+    }
+  }
+
+  void Pca9685Servos::write(int gatenum, int pulseUs)
+  {
+    int channel = channelOf(gatenum);
+    if (channel == -1) return;
+    long count = ((long)pulseUs * (PCA9685_OSC_HZ / 1000) / (prescale + 1) + 500) / 1000;
+    if (count > 4095) count = 4095;
+    if (pulseCount[channel] == count) return;
+    pulseCount[channel] = count;
+    uint16_t bit = 1u << (channel % channels);
+    if (attached[channel / channels] & bit) dirty[channel / channels] |= bit;
+  }
+
+  void Pca9685Servos::attach(int gatenum)
+  {
+    int channel = channelOf(gatenum);
+    if (channel == -1) return;
+    uint16_t bit = 1u << (channel % channels);
+    attached[channel / channels] |= bit;
+    dirty[channel / channels] |= bit;
+  }
+
+  void Pca9685Servos::detach(int gatenum)
+  {
+    int channel = channelOf(gatenum);
+    if (channel == -1) return;
+    uint16_t bit = 1u << (channel % channels);
+    attached[channel / channels] &= ~bit;
+    dirty[channel / channels] |= bit;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // flush()
+  //
+  // Send every changed channel, one transaction for each run of up to
+  // batch_channels channels starting at the lowest changed one
+  //////////////////////////////////////////////////////////////////////
+  void Pca9685Servos::flush()
+  {
+    for (int board = 0; board < boards; board++) {
+      uint16_t pending = dirty[board];
+      dirty[board] = 0;
+      int first = 0;
+      while (pending) {
+        while (!(pending & (1u << first))) first++;
+        int last = first;
+        for (int ch = first + 1; ch < first + batch_channels && ch < channels; ch++)
+          if (pending & (1u << ch)) last = ch;
+        sendChannels(board, first, last);
+        for (int ch = first; ch <= last; ch++) pending &= ~(1u << ch);
+        first = last + 1;
+      }
+    }
+  }
+
+  int Pca9685Servos::channelOf(int gatenum)
+  {
+    int channel = GateConfig::servoPin(gatenum);
+    return channel >= 0 && channel < boards * channels ? channel : -1;
+  }
+
+  void Pca9685Servos::writeRegister(int board, uint8_t reg, uint8_t value)
+  {
+    Wire.beginTransmission(PCA9685_ADDRESS + board);
+    Wire.write(reg);
+    Wire.write(value);
+    endTransaction(board);
+  }
+
+  // Send the buffered transaction, reporting the first one a board doesn't acknowledge
+  void Pca9685Servos::endTransaction(int board)
+  {
+    (void)board;   // only used by the message, which a release build leaves out
+    if (Wire.endTransmission() == 0 || busError) return;
+    busError = true;
+    EPRINT(F("PCA9685 at 0x")); EPRINT(PCA9685_ADDRESS + board, HEX); EPRINTLN(F(" is not answering"));
+  }
+
+  // Write channels first to last of a board in one transaction, each pulse starting at the top of the frame
+  void Pca9685Servos::sendChannels(int board, int first, int last)
+  {
+    Wire.beginTransmission(PCA9685_ADDRESS + board);
+    Wire.write(reg_led0 + 4 * first);
+    for (int ch = first; ch <= last; ch++) {
+      uint16_t off = attached[board] & (1u << ch) ? pulseCount[board * channels + ch] : full_off;
+      Wire.write(0);                 // ON_L, ON_H
+      Wire.write(0);
+      Wire.write(off & 0xff);        // OFF_L, OFF_H
+      Wire.write(off >> 8);
+    }
+    endTransaction(board);
+  }
+
+#endif
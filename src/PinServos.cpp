@@ -0,0 +1,26 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "PinServos.h"
+
+#if SERVO_BACKEND == SERVO_BACKEND_PINS
+
+  #ifdef MAX_SERVOS
+  static_assert(GateConfig::count <= MAX_SERVOS, "the Servo library can't drive this many gates, use SERVO_BACKEND_PCA9685");
+  #endif
+
+  void PinServos::write(int gatenum, int pulseUs)
+  {
+    servo[gatenum].writeMicroseconds(pulseUs);
+  }
+
+  void PinServos::attach(int gatenum)
+  {
+    servo[gatenum].attach(GateConfig::servoPin(gatenum));
+  }
+
+  void PinServos::detach(int gatenum)
+  {
+    servo[gatenum].detach();
+  }
+
+#endif
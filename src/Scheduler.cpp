@@ -0,0 +1,113 @@
+#include "Arduino.h"
+#include "Scheduler.h"
+#ifdef __AVR__
+#include <avr/sleep.h>
+#endif
+
+  static void saturate(uint16_t &worst, unsigned long value)
+  {
+    if (value > 0xffff) value = 0xffff;
+    if (value > worst) worst = value;
+  }
+
+  int Scheduler::add(const __FlashStringHelper *name, TaskFunction function, unsigned long periodUs, unsigned long deadlineUs)
+  {
+    if (count >= max_tasks) return -1;
+    Task &t = tasks[count];
+    t.function = function;
+    t.name = name;
+    t.periodUs = periodUs;
+    t.deadlineUs = deadlineUs ? deadlineUs : periodUs;
+    t.due = micros() + periodUs;
+    t.runs = 0;
+    t.overruns = 0;
+    t.worstLateUs = 0;
+    t.worstRunUs = 0;
+    return count++;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // run()
+  //
+  // Start the first due task in the table and record how late it started,
+  // how long it ran and whether it finished within its deadline. Sleeps
+  // when no task is due. Call it from loop() on every pass.
+  //////////////////////////////////////////////////////////////////////
+  void Scheduler::run()
+  {
+    unsigned long now = micros();
+    for (int x = 0; x < count; x++) {
+      Task &t = tasks[x];
+      if ((long)(now - t.due) < 0) continue;
+
+      t.function();
+      unsigned long finished = micros();
+
+      t.runs++;
+      saturate(t.worstLateUs, now - t.due);
+      saturate(t.worstRunUs, finished - now);
+      if (finished - t.due > t.deadlineUs && t.overruns < 0xffff) t.overruns++;
+
+      // Next release one period on, skipping any that have already gone by
+      t.due += t.periodUs;
+      if ((long)(finished - t.due) >= 0) t.due += ((finished - t.due) / t.periodUs + 1) * t.periodUs;
+      return;
+    }
+    idle(now);
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // idle(unsigned long now)
+  //
+  // Nothing is due. On the Uno the CPU stops in idle sleep until the next
+  // interrupt, the timers, sampler, servo pulses and serial port all keep
+  // running and any of them wakes it within about a millisecond. The host
+  // build skips the simulated clock ahead to the next release instead.
+  //////////////////////////////////////////////////////////////////////
+  void Scheduler::idle(unsigned long now)
+  {
+    #ifdef __AVR__
+    (void)now;
+    set_sleep_mode(SLEEP_MODE_IDLE);
+    sleep_mode();
+    #else
+    if (count == 0) return;
+    unsigned long wait = 0xffffffff;
+    for (int x = 0; x < count; x++) {
+      unsigned long until = tasks[x].due - now;
+      if (until < wait) wait = until;
+    }
+    delay(wait / 1000);
+    delayMicroseconds(wait % 1000);
+    #endif
+  }
+
+  void Scheduler::clearStats()
+  {
+    for (int x = 0; x < count; x++) {
+      tasks[x].runs = 0;
+      tasks[x].overruns = 0;
+      tasks[x].worstLateUs = 0;
+      tasks[x].worstRunUs = 0;
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // dump(Print &out)
+  //
+  // Print each task's period, how often it ran, its overruns and the
+  // worst start delay and run time seen (saturating at 65535 us)
+  //////////////////////////////////////////////////////////////////////
+  void Scheduler::dump(Print &out)
+  {
+    out.println(F("Task timing (us)"));
+    for (int x = 0; x < count; x++) {
+      Task &t = tasks[x];
+      out.print(F("  ")); out.print(t.name);
+      out.print(F(": every ")); out.print(t.periodUs);
+      out.print(F(", ")); out.print(t.runs); out.print(F(" runs, "));
+      out.print(t.overruns); out.print(F(" overruns, worst late "));
+      out.print(t.worstLateUs); out.print(F(", worst run "));
+      out.println(t.worstRunUs);
+    }
+  }
@@ -0,0 +1,134 @@
+#include "Arduino.h"
+#include <EEPROM.h>
+#include "Debug.h"
+#include "Configuration.h"
+#include "SettingsStore.h"
+#include "GateServos.h"
+
+  SettingsStore::SettingsStore()
+  {
+    memset(&record, 0, sizeof(record));
+    record.magic = record_magic;
+    record.version = record_version;
+    record.numSensors = NUM_AC_SENSORS;
+    record.numGates = NUM_GATES;
+    record.detectionMode = DETECTION_MODE;
+    record.windowCycles = DETECT_WINDOW_CYCLES;
+    record.sampleRate = ADC_SAMPLE_RATE_HZ;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // load()
+  //
+  // Read the saved record. Returns false, and keeps a blank record with
+  // every gate position unknown, if it is missing, corrupt or was saved
+  // with a different configuration.
+  //////////////////////////////////////////////////////////////////////
+  bool SettingsStore::load()
+  {
+    Record saved;
+    EEPROM.get(record_address, saved);
+
+    if (saved.crc != crc8((const uint8_t *)&saved, offsetof(Record, crc))) {
+      IPRINTLN(F("Saved settings missing or corrupt"));
+      return false;
+    }
+    if (saved.magic != record.magic || saved.version != record.version ||
+        saved.numSensors != record.numSensors || saved.numGates != record.numGates ||
+        saved.detectionMode != record.detectionMode || saved.windowCycles != record.windowCycles ||
+        saved.sampleRate != record.sampleRate) {
+      IPRINTLN(F("Saved settings are for a different configuration"));
+      return false;
+    }
+
+    record = saved;
+    IPRINTLN(F("Loaded saved settings"));
+    return true;
+  }
+
+  bool SettingsStore::hasBaselines()
+  {
+    return record.hasBaselines;
+  }
+
+  const float *SettingsStore::offReadings()
+  {
+    return record.offReadings;
+  }
+
+  const uint8_t *SettingsStore::gatePositions()
+  {
+    return record.gatePosition;
+  }
+
+  void SettingsStore::saveBaselines(const float *offReadings)
+  {
+    if (record.hasBaselines && memcmp(record.offReadings, offReadings, sizeof(record.offReadings)) == 0) return;
+    memcpy(record.offReadings, offReadings, sizeof(record.offReadings));
+    record.hasBaselines = true;
+    write();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // saveGatePositions(const uint8_t *positions)
+  //
+  // Save the gates that have moved onto or off closed. Only closed
+  // lets a warm boot skip homing, so a gate going from unknown to open
+  // keeps its saved unknown, and nothing is written if no gate changed.
+  //////////////////////////////////////////////////////////////////////
+  void SettingsStore::saveGatePositions(const uint8_t *positions)
+  {
+    bool changed = false;
+    for (int g = 0; g < NUM_GATES; g++) {
+      if ((positions[g] == GateServos::GATE_POSITION_CLOSED) == (record.gatePosition[g] == GateServos::GATE_POSITION_CLOSED)) continue;
+      record.gatePosition[g] = positions[g];
+      changed = true;
+    }
+    if (changed) write();
+  }
+
+  const uint16_t *SettingsStore::travelOpenMs()
+  {
+    return record.travelOpenMs;
+  }
+
+  const uint16_t *SettingsStore::travelCloseMs()
+  {
+    return record.travelCloseMs;
+  }
+
+  void SettingsStore::saveTravelTimes(const uint16_t *openMs, const uint16_t *closeMs)
+  {
+    if (memcmp(record.travelOpenMs, openMs, sizeof(record.travelOpenMs)) == 0 &&
+        memcmp(record.travelCloseMs, closeMs, sizeof(record.travelCloseMs)) == 0) return;
+    memcpy(record.travelOpenMs, openMs, sizeof(record.travelOpenMs));
+    memcpy(record.travelCloseMs, closeMs, sizeof(record.travelCloseMs));
+    write();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // write()
+  //
+  // Only called when the record changed. Each byte goes through
+  // EEPROM.update(), so only the cells that differ are written, and a
+  // CRC that comes out the same is left alone.
+  //////////////////////////////////////////////////////////////////////
+  void SettingsStore::write()
+  {
+    record.crc = crc8((const uint8_t *)&record, offsetof(Record, crc));
+    const uint8_t *bytes = (const uint8_t *)&record;
+    for (size_t i = 0; i < offsetof(Record, crc); i++) EEPROM.update(record_address + i, bytes[i]);
+    EEPROM.update(record_address + offsetof(Record, crc), record.crc);
+  }
+
+  // CRC-8, polynomial 0x07
+  uint8_t SettingsStore::crc8(const uint8_t *data, int len)
+  {
+    uint8_t crc = 0;
+    for (int i = 0; i < len; i++) {
+      crc ^= data[i];
+      for (int bit = 0; bit < 8; bit++)
+        crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+    return crc;
+  }
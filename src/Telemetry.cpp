@@ -0,0 +1,110 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "Debug.h"
+#include "Telemetry.h"
+
+#if ENABLE_TELEMETRY
+
+  #if LOG_LEVEL > LOG_LEVEL_NONE
+  #error "ENABLE_TELEMETRY and the log both use the serial port, build telemetry without DEBUG or LOG_LEVEL"
+  #endif
+
+  static const int max_payload = 9;          // id, 2 byte time, up to three arguments
+  static uint16_t timeHigh = 0;              // high 16 bits of millis() in the last TM_TIME
+  static bool timeSent = false;
+  static uint16_t dropped = 0;               // frames that didn't fit since the last TM_DROPPED
+
+  // Write a frame if the transmit buffer has room for all of it, never wait
+  static bool sendFrame(const uint8_t *payload, uint8_t length)
+  {
+    if (Serial.availableForWrite() < length + 4) {
+      if (dropped < 0xffff) dropped++;
+      return false;
+    }
+    uint8_t sum = Telemetry::frame_event + length;
+    for (int x = 0; x < length; x++) sum += payload[x];
+    Serial.write(Telemetry::frame_sync);
+    Serial.write(Telemetry::frame_event);
+    Serial.write(length);
+    Serial.write(payload, length);
+    Serial.write(sum);
+    return true;
+  }
+
+  // Build and send one event: id, 16 bit time, then the arguments. False if it was dropped
+  static bool sendEvent(Telemetry::Event event, unsigned long now, const int16_t *args, int count, bool firstIsByte)
+  {
+    uint8_t payload[max_payload];
+    uint8_t length = 0;
+    payload[length++] = event;
+    payload[length++] = now & 0xff;
+    payload[length++] = (now >> 8) & 0xff;
+    for (int x = 0; x < count; x++) {
+      payload[length++] = args[x] & 0xff;
+      if (x > 0 || !firstIsByte) payload[length++] = (args[x] >> 8) & 0xff;
+    }
+    return sendFrame(payload, length);
+  }
+
+  // Anything that must go out before an event: the full time if the short
+  // one wrapped, and the count of frames that were dropped
+  static unsigned long prepare()
+  {
+    unsigned long now = millis();
+    if (!timeSent || (uint16_t)(now >> 16) != timeHigh) Telemetry::logTime(now);
+    if (dropped) {
+      // Cleared only once the report is queued. One that doesn't fit isn't
+      // a lost event itself, so the count it carried is kept as it was.
+      int16_t count = dropped;
+      dropped = sendEvent(Telemetry::TM_DROPPED, now, &count, 1, false) ? 0 : count;
+    }
+    return now;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // begin()
+  //
+  // Open the serial port for telemetry and send the starting time
+  //////////////////////////////////////////////////////////////////////
+  void Telemetry::begin()
+  {
+    Serial.begin(TELEMETRY_BAUD);
+    logTime(millis());
+  }
+
+  void Telemetry::logTime(unsigned long now)
+  {
+    uint8_t payload[5] = { TM_TIME, (uint8_t)(now & 0xff), (uint8_t)((now >> 8) & 0xff),
+                           (uint8_t)((now >> 16) & 0xff), (uint8_t)((now >> 24) & 0xff) };
+    // Only counts as sent if the decoder will see it, otherwise retry with the next event
+    timeSent = sendFrame(payload, sizeof(payload));
+    if (timeSent) timeHigh = now >> 16;
+  }
+
+  void Telemetry::log(Event event)
+  {
+    unsigned long now = prepare();
+    sendEvent(event, now, NULL, 0, false);
+  }
+
+  void Telemetry::log(Event event, int16_t value)
+  {
+    unsigned long now = prepare();
+    sendEvent(event, now, &value, 1, false);
+  }
+
+  void Telemetry::log(Event event, uint8_t index, int16_t value)
+  {
+    unsigned long now = prepare();
+    int16_t args[2] = { index, value };
+    sendEvent(event, now, args, 2, true);
+  }
+
+  void Telemetry::log(Event event, uint8_t index, int16_t value, int16_t extra)
+  {
+    unsigned long now = prepare();
+    int16_t args[3] = { index, value, extra };
+    sendEvent(event, now, args, 3, true);
+  }
+
+#endif
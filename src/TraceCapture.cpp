@@ -0,0 +1,98 @@
+#include "Arduino.h"
+#include "Configuration.h"
+#include "Debug.h"
+#include "TraceCapture.h"
+#include "AdcSampler.h"
+#include "GateConfig.h"
+
+  #if defined(TRACE_CAPTURE) && LOG_LEVEL > LOG_LEVEL_NONE
+  #error "TRACE_CAPTURE sends binary frames on the serial port, build it without DEBUG or LOG_LEVEL"
+  #endif
+
+  // Each sample costs 2 bytes plus its share of a frame's 10 bytes of overhead, 10 bits per byte on the wire
+  static_assert((long)ADC_SAMPLE_RATE_HZ * (2 * TraceCapture::batch_size + 10) / TraceCapture::batch_size * 10 <= TRACE_BAUD,
+                "TRACE_BAUD too slow for ADC_SAMPLE_RATE_HZ");
+  static_assert(TraceCapture::batch_size <= AdcSampler::ring_size, "a batch must fit in the sampler ring");
+
+  static const int num_sensors = NUM_AC_SENSORS;
+
+  static unsigned long sequence[num_sensors];   // samples sent so far for each sensor
+  static int framesSinceHeader = 0;
+
+  // Write a complete frame, the checksum covers everything after the sync byte
+  static void sendFrame(uint8_t type, const uint8_t *payload, uint8_t length)
+  {
+    uint8_t sum = type + length;
+    for (int x = 0; x < length; x++) sum += payload[x];
+    Serial.write(TraceCapture::frame_sync);
+    Serial.write(type);
+    Serial.write(length);
+    Serial.write(payload, length);
+    Serial.write(sum);
+  }
+
+  static void sendHeader()
+  {
+    uint16_t mask = 0;
+    for (int x = 0; x < num_sensors; x++)
+      if (GateConfig::sensorPin(x) != -1) mask |= 1U << x;
+
+    long rate = AdcSampler::channelRate();
+    uint8_t payload[7] = { TraceCapture::trace_version, (uint8_t)num_sensors, (uint8_t)(mask & 0xff), (uint8_t)(mask >> 8),
+                           (uint8_t)(rate & 0xff), (uint8_t)(rate >> 8), MAINS_HZ };
+    sendFrame(TraceCapture::frame_header, payload, sizeof(payload));
+    framesSinceHeader = 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // begin()
+  //
+  // Open the serial port at TRACE_BAUD and start the background sampler
+  // on every configured sensor pin
+  //////////////////////////////////////////////////////////////////////
+  void TraceCapture::begin()
+  {
+    Serial.begin(TRACE_BAUD);
+    for (int x = 0; x < num_sensors; x++) sequence[x] = 0;
+    AdcSampler::begin(num_sensors);
+    sendHeader();
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // poll()
+  //
+  // Send one frame for each sensor with at least batch_size samples waiting.
+  // Serial.write() blocks once its buffer is full, the sampler rings
+  // cover the wait as long as TRACE_BAUD keeps up with the sample rate.
+  //////////////////////////////////////////////////////////////////////
+  void TraceCapture::poll()
+  {
+    uint8_t payload[6 + 2 * AdcSampler::ring_size];
+
+    for (int x = 0; x < num_sensors; x++)
+    {
+      // Wait for a full batch, small frames would spend the link on framing
+      int count = AdcSampler::available(x);
+      if (count < batch_size) continue;
+
+      unsigned long seq = sequence[x];
+      payload[0] = x;
+      payload[1] = seq & 0xff;
+      payload[2] = (seq >> 8) & 0xff;
+      payload[3] = (seq >> 16) & 0xff;
+      payload[4] = (seq >> 24) & 0xff;
+      payload[5] = AdcSampler::overruns() & 0xff;
+
+      uint8_t length = 6;
+      for (int y = 0; y < count; y++)
+      {
+        int sample = AdcSampler::read(x);
+        payload[length++] = sample & 0xff;
+        payload[length++] = sample >> 8;
+      }
+      sequence[x] += count;
+      sendFrame(frame_samples, payload, length);
+
+      if (++framesSinceHeader >= header_interval) sendHeader();
+    }
+  }
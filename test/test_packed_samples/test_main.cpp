@@ -0,0 +1,83 @@
+/*
+  test_main.cpp - Host checks of the sensor averaging windows, run with pio test -e test
+  Released into the public domain.
+*/
+#include <stdlib.h>
+#include <unity.h>
+#include "PackedSamples.h"
+
+  static int randomSample()
+  {
+    return rand() % 1024;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Slide random 10 bit values through a PackedSamples window and a plain
+  // uint16_t array the way AcSensors::ReadSensors() does, checking the
+  // running total against a fresh sum of the array after every reading,
+  // and the values, sum of squares (RMS) and min/max (peak) read back.
+  //////////////////////////////////////////////////////////////////////
+  template <int size>
+  static void checkWindow(int readings)
+  {
+    PackedSamples<size> packed;
+    uint16_t plain[size] = {};
+    long total = 0;
+    int index = 0;
+
+    for (int r = 0; r < readings; r++) {
+      int value = randomSample();
+      if (r % 97 == 0) value = 1023;          // the ends of the range now and then
+      if (r % 89 == 0) value = 0;
+      index = (index + 1) % size;
+      total += value - packed.get(index);
+      packed.set(index, value);
+      plain[index] = value;
+
+      long sum = 0, squares = 0, packedSquares = 0;
+      int lo = 1023, hi = 0, packedLo = 1023, packedHi = 0;
+      for (int x = 0; x < size; x++) {
+        int got = packed.get(x);
+        TEST_ASSERT_EQUAL_INT(plain[x], got);
+        sum += plain[x];
+        squares += (long)plain[x] * plain[x];
+        packedSquares += (long)got * got;
+        if (plain[x] < lo) lo = plain[x];
+        if (plain[x] > hi) hi = plain[x];
+        if (got < packedLo) packedLo = got;
+        if (got > packedHi) packedHi = got;
+      }
+      TEST_ASSERT_EQUAL_INT32(sum, total);
+      TEST_ASSERT_EQUAL_INT32(squares, packedSquares);
+      TEST_ASSERT_EQUAL_INT(lo, packedLo);
+      TEST_ASSERT_EQUAL_INT(hi, packedHi);
+    }
+  }
+
+  // Whole groups of four, a part group at the end, and a single value
+  void test_packed_window_16() { checkWindow<16>(5000); }
+  void test_packed_window_10() { checkWindow<10>(5000); }
+  void test_packed_window_1() { checkWindow<1>(500); }
+
+  void test_packed_starts_zero_and_clears()
+  {
+    PackedSamples<7> packed;
+    for (int x = 0; x < 7; x++) TEST_ASSERT_EQUAL_INT(0, packed.get(x));
+    for (int x = 0; x < 7; x++) packed.set(x, 1023);
+    packed.clear();
+    for (int x = 0; x < 7; x++) TEST_ASSERT_EQUAL_INT(0, packed.get(x));
+  }
+
+  void setUp() {}
+  void tearDown() {}
+
+int main()
+{
+  srand(1);
+  UNITY_BEGIN();
+  RUN_TEST(test_packed_window_16);
+  RUN_TEST(test_packed_window_10);
+  RUN_TEST(test_packed_window_1);
+  RUN_TEST(test_packed_starts_zero_and_clears);
+  return UNITY_END();
+}
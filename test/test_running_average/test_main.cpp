@@ -0,0 +1,86 @@
+/*
+  test_main.cpp - Host checks of the AcSensors running-sum average, run with pio test -e test
+  Released into the public domain.
+*/
+#include <stdlib.h>
+#include <unity.h>
+#include "Arduino.h"
+#include "Configuration.h"
+#include "AcSensors.h"
+#include "AdcSampler.h"
+#include "GateConfig.h"
+#include "SimShop.h"
+
+  static int randomSample()
+  {
+    return rand() % 1024;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Hold every sensor at its own random level for a pass, run
+  // ReadSensors() and compare AvgSensorReading() with the average of the
+  // last window pass levels worked out from scratch. The window starts out
+  // all zero, so the first window - 1 passes average the missing readings
+  // as zero, and after window passes the oldest level drops out.
+  //////////////////////////////////////////////////////////////////////
+  static const unsigned long pass_ms = 50;
+  static const int max_passes = 200;
+  static int sensorLevel[NUM_AC_SENSORS];
+
+  static int levelSource(int pin, unsigned long long time)
+  {
+    (void)time;
+    for (int x = 0; x < NUM_AC_SENSORS; x++)
+      if (GateConfig::sensorPin(x) == pin) return sensorLevel[x];
+    return 0;
+  }
+
+  static void checkRunningAverage(int window, int passes)
+  {
+    SimShop::reset();
+    unsigned long callCost = SimShop::callCost;
+    SimShop::callCost = 0;                    // no samples taken while ReadSensors() reads the clock
+    for (int x = 0; x < NUM_AC_SENSORS; x++) {
+      sensorLevel[x] = 0;
+      if (GateConfig::sensorPin(x) != -1) SimShop::sensors[GateConfig::sensorPin(x)].source = levelSource;
+    }
+
+    AcSensors acsensors;
+    float baselines[NUM_AC_SENSORS] = {};
+    acsensors.InitializeSensors(baselines);
+    delay(pass_ms);
+    acsensors.ReadSensors();                  // drop whatever was sampled while starting up
+    acsensors.SetTuning(AC_SENSOR_SENSITIVITY_ON, AC_SENSOR_SENSITIVITY_OFF, DEBOUNCE_STABLE_READINGS, window);
+
+    static int history[NUM_AC_SENSORS][max_passes];
+    for (int p = 0; p < passes && p < max_passes; p++) {
+      for (int x = 0; x < NUM_AC_SENSORS; x++) history[x][p] = sensorLevel[x] = randomSample();
+      delay(pass_ms);
+      acsensors.ReadSensors();
+
+      for (int x = 0; x < NUM_AC_SENSORS; x++) {
+        if (GateConfig::sensorPin(x) == -1) continue;
+        long sum = 0;
+        for (int h = p; h >= 0 && h > p - window; h--) sum += history[x][h];
+        TEST_ASSERT_EQUAL_FLOAT((float)sum / (float)window, acsensors.AvgSensorReading(x));
+      }
+    }
+    AdcSampler::end();
+    SimShop::callCost = callCost;
+  }
+
+  // The configured window, and a short one that isn't a whole number of PackedSamples groups
+  void test_running_average_full_window() { checkRunningAverage(AVG_READINGS, 4 * AVG_READINGS + 3); }
+  void test_running_average_short_window() { checkRunningAverage(6, 40); }
+
+  void setUp() {}
+  void tearDown() {}
+
+int main()
+{
+  srand(1);
+  UNITY_BEGIN();
+  RUN_TEST(test_running_average_full_window);
+  RUN_TEST(test_running_average_short_window);
+  return UNITY_END();
+}
@@ -0,0 +1,103 @@
+/*
+  Bench.cpp - Times the detection threshold checks in floating point, the
+  way AcSensors used to make them, against the fixed point checks it makes now
+
+  Usage: bench [--iterations N]
+    --iterations N   passes over all the sensors for each check (default 2000000)
+
+  The host has a floating point unit, so the difference here is much smaller
+  than on the Uno, where every float multiply, divide and compare is a call
+  into the soft float library costing tens to hundreds of cycles and the
+  fixed point check is a single long compare.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include "Arduino.h"
+#include "Configuration.h"
+#include "AcSensors.h"
+#include "SimShop.h"
+
+  static const int sensors = NUM_AC_SENSORS;
+
+  static float offReading[sensors];
+  static float sensitivityOn = AC_SENSOR_SENSITIVITY_ON;
+  static float sensitivityOff = AC_SENSOR_SENSITIVITY_OFF;
+  static long windowTotal[sensors];
+  static int window = AVG_READINGS;
+  static bool state[sensors];
+  static long onLimit[sensors];
+  static long offLimit[sensors];
+  static int sample[sensors];
+  static int sampleOnLimit[sensors];
+  static volatile int sink;
+
+  // Debounce reading (Triggered) and per sample onset (processSample) checks, as they were
+  static bool floatReading(int s)
+  {
+    float avgReading = (float)windowTotal[s] / (float)window;
+    float threshold = state[s] ? offReading[s] * sensitivityOff : offReading[s] * sensitivityOn;
+    return avgReading > threshold;
+  }
+  static bool floatSample(int s) { return sample[s] > offReading[s] * sensitivityOn; }
+
+  // and as they are now, against thresholds worked out once
+  static bool fixedReading(int s) { return windowTotal[s] > (state[s] ? offLimit[s] : onLimit[s]); }
+  static bool fixedSample(int s) { return sample[s] > sampleOnLimit[s]; }
+
+  static AcSensors *acsensors;
+  static bool triggered(int s) { return acsensors->Triggered(s); }
+
+  // Host nanoseconds per sensor for one check, a template so the check is inlined
+  template <bool (*check)(int)> static double timeCheck(long iterations)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    int hits = 0;
+    for (long i = 0; i < iterations; i++) {
+      asm volatile("" ::: "memory");   // the inputs may have changed, so nothing is hoisted out of the loop
+      for (int s = 0; s < sensors; s++) hits += check(s);
+    }
+    sink = hits;
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    return ns / ((double)iterations * sensors);
+  }
+
+  static void report(const char *name, double floatNs, double fixedNs)
+  {
+    printf("  %-26s float %6.2f ns, fixed %6.2f ns, %.1fx\n", name, floatNs, fixedNs, fixedNs > 0 ? floatNs / fixedNs : 0);
+  }
+
+  int main(int argc, char **argv)
+  {
+    long iterations = 2000000;
+    for (int i = 1; i < argc; i++) {
+      if (!strcmp(argv[i], "--iterations") && i + 1 < argc) iterations = strtol(argv[++i], NULL, 10);
+      else { fprintf(stderr, "usage: bench [--iterations N]\n"); return 2; }
+    }
+
+    // Baselines and readings either side of the thresholds, so both outcomes are timed
+    for (int s = 0; s < sensors; s++) {
+      offReading[s] = 30 + s;
+      windowTotal[s] = (long)((s % 2 ? 1.9 : 2.1) * offReading[s] * window);
+      state[s] = s % 3 == 0;
+      onLimit[s] = (long)(offReading[s] * sensitivityOn * window);
+      offLimit[s] = (long)(offReading[s] * sensitivityOff * window);
+      sample[s] = (int)((s % 2 ? 1.9 : 2.1) * offReading[s]);
+      sampleOnLimit[s] = (int)(offReading[s] * sensitivityOn);
+    }
+
+    SimShop::reset();
+    float saved[NUM_AC_SENSORS];
+    for (int s = 0; s < sensors; s++) saved[s] = offReading[s];
+    acsensors = new AcSensors();
+    acsensors->InitializeSensors(saved);
+    delay(1000);
+    acsensors->ReadSensors();
+
+    printf("Detection checks per sensor, %d sensors, %ld iterations\n", sensors, iterations);
+    report("Triggered() reading", timeCheck<floatReading>(iterations), timeCheck<fixedReading>(iterations));
+    report("onset check per sample", timeCheck<floatSample>(iterations), timeCheck<fixedSample>(iterations));
+    printf("  %-26s %6.2f ns (fixed point, with debounce)\n", "AcSensors::Triggered()", timeCheck<triggered>(iterations));
+    return 0;
+  }
@@ -0,0 +1,120 @@
+#!/usr/bin/env python3
+"""Save the sensor trace streamed by a TRACE_CAPTURE build (pio run -e uno-trace).
+
+Usage: capture_trace.py PORT TRACE [--baud 250000] [--labels FILE]
+
+While capturing, type a sensor number and Enter each time you switch that
+tool on or off. The runs are written to the label file (TRACE.labels by
+default) in trace time, ready for tools/replay. Keep every tool off for the
+first second so the replay can calibrate. Type q and Enter to stop.
+
+Needs pyserial, which comes with PlatformIO.
+"""
+import argparse
+import sys
+import threading
+import time
+
+import serial
+
+FRAME_SYNC = 0xA5
+FRAME_HEADER = ord('H')
+FRAME_SAMPLES = ord('S')
+
+
+class TraceTimer:
+    """Follows the frames going past to know the current trace time."""
+
+    def __init__(self):
+        self.buffer = bytearray()
+        self.rate = 0
+        self.latest_ms = 0
+        self.frames = 0
+
+    def feed(self, data):
+        self.buffer += data
+        while len(self.buffer) >= 4:
+            if self.buffer[0] != FRAME_SYNC:
+                del self.buffer[0]
+                continue
+            frame_type, length = self.buffer[1], self.buffer[2]
+            if len(self.buffer) < length + 4:
+                return
+            payload = self.buffer[3:3 + length]
+            if (frame_type + length + sum(payload)) & 0xff != self.buffer[3 + length]:
+                del self.buffer[0]
+                continue
+            del self.buffer[:length + 4]
+            self.frames += 1
+            if frame_type == FRAME_HEADER and length >= 6:
+                # version 1 headers have a 1 byte sensor mask, later ones 2
+                rate_at = 3 if payload[0] == 1 else 4
+                self.rate = payload[rate_at] | (payload[rate_at + 1] << 8)
+            elif frame_type == FRAME_SAMPLES and length >= 6 and self.rate:
+                seq = int.from_bytes(payload[1:5], 'little')
+                end = seq + (length - 6) // 2
+                self.latest_ms = max(self.latest_ms, end * 1000 // self.rate)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('port')
+    parser.add_argument('trace')
+    parser.add_argument('--baud', type=int, default=250000, help='TRACE_BAUD from Configuration.h')
+    parser.add_argument('--labels', help='label file to write (default TRACE.labels)')
+    args = parser.parse_args()
+    label_path = args.labels or args.trace + '.labels'
+
+    # Opening the port resets the Uno, so the capture starts with a fresh header
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+    timer = TraceTimer()
+    stop = threading.Event()
+
+    def reader():
+        with open(args.trace, 'wb') as out:
+            while not stop.is_set():
+                data = port.read(4096)
+                if data:
+                    out.write(data)
+                    timer.feed(data)
+
+    thread = threading.Thread(target=reader, daemon=True)
+    thread.start()
+    print('Capturing to %s, type a sensor number and Enter when its tool switches, q to stop' % args.trace)
+
+    running = {}
+    runs = []
+    try:
+        for line in sys.stdin:
+            line = line.strip()
+            if line == 'q':
+                break
+            if not line.isdigit():
+                print('type a sensor number (1-16) or q')
+                continue
+            sensor = int(line)
+            now = timer.latest_ms
+            if sensor in running:
+                runs.append((sensor, running.pop(sensor), now))
+                print('  tool %d off at %d ms' % (sensor, now))
+            else:
+                running[sensor] = now
+                print('  tool %d on at %d ms' % (sensor, now))
+    except KeyboardInterrupt:
+        pass
+
+    stop.set()
+    thread.join()
+    port.close()
+    for sensor, on in running.items():
+        runs.append((sensor, on, timer.latest_ms))
+
+    with open(label_path, 'w') as out:
+        out.write('# sensor on_ms off_ms, captured %s\n' % time.strftime('%Y-%m-%d %H:%M'))
+        for sensor, on, off in sorted(runs, key=lambda run: run[1]):
+            out.write('%d %d %d\n' % (sensor, on, off))
+    print('%d frames, %.1f s of trace, %d tool runs written to %s' % (timer.frames, timer.latest_ms / 1000.0, len(runs), label_path))
+
+
+if __name__ == '__main__':
+    main()
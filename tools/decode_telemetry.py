@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Turn the binary telemetry stream (ENABLE_TELEMETRY, pio run -e uno-telemetry)
+back into readable lines.
+
+Usage: decode_telemetry.py SOURCE [--baud 250000]
+
+SOURCE is a serial port or a file holding a saved stream. Text that is not
+part of a frame, such as the boot messages of a build with logging on, is
+passed through as it is.
+
+Needs pyserial for serial ports, which comes with PlatformIO.
+"""
+import argparse
+import os
+import sys
+
+FRAME_SYNC = 0xA5
+FRAME_EVENT = ord('E')
+
+# Must match the Event enum in include/Telemetry.h. Each entry is the name and
+# the argument labels, with x10 values shown divided by 10.
+EVENTS = [
+    ('TIME', []),
+    ('BOOT', ['warm']),
+    ('DROPPED', ['frames']),
+    ('BASELINE', ['sensor', 'off/10']),
+    ('SENSOR_ON', ['sensor', 'reading/10', 'threshold/10']),
+    ('SENSOR_OFF', ['sensor', 'reading/10', 'threshold/10']),
+    ('GATE_OPEN', ['gate', 'position']),
+    ('GATE_CLOSE', ['gate', 'position']),
+    ('GATE_QUEUED', ['gate', 'open']),
+    ('MOVE_START', ['gate', 'target']),
+    ('MOVE_DONE', ['gate']),
+    ('BUTTON', ['gate']),
+    ('ERROR_STATE', ['ops']),
+    ('FAST_OPEN', ['gate']),
+    ('FAST_RETRACT', ['gate']),
+    ('TRAVEL_TIME', ['gate', 'open_ms', 'close_ms']),
+]
+
+
+class Decoder:
+    def __init__(self, out):
+        self.out = out
+        self.buffer = bytearray()
+        self.text = bytearray()
+        self.time_high = None
+        self.last_ms = None
+
+    def feed(self, data):
+        self.buffer += data
+        while self.buffer:
+            if self.buffer[0] != FRAME_SYNC:
+                self.passthrough(self.buffer[0])
+                del self.buffer[0]
+                continue
+            if len(self.buffer) < 4:
+                return
+            length = self.buffer[2]
+            if self.buffer[1] != FRAME_EVENT or length < 3:
+                self.passthrough(self.buffer[0])
+                del self.buffer[0]
+                continue
+            if len(self.buffer) < length + 4:
+                return
+            payload = self.buffer[3:3 + length]
+            if (FRAME_EVENT + length + sum(payload)) & 0xff != self.buffer[3 + length]:
+                self.passthrough(self.buffer[0])
+                del self.buffer[0]
+                continue
+            del self.buffer[:length + 4]
+            self.event(bytes(payload))
+
+    def passthrough(self, byte):
+        if byte == ord('\n'):
+            self.out.write(self.text.decode('ascii', 'replace').rstrip('\r') + '\n')
+            self.text.clear()
+        elif 32 <= byte < 127 or byte in (9, 13):
+            self.text.append(byte)
+
+    def event(self, payload):
+        event = payload[0]
+        if event == 0 and len(payload) >= 5:
+            now = int.from_bytes(payload[1:5], 'little')
+            self.time_high = now >> 16
+            self.last_ms = now
+            return
+        short = payload[1] | (payload[2] << 8)
+        # Rebuild the full time, noticing a wrap a TM_TIME frame was dropped for
+        if self.time_high is None:
+            now = short
+        else:
+            now = (self.time_high << 16) | short
+            if self.last_ms is not None and now < self.last_ms:
+                self.time_high += 1
+                now += 0x10000
+        self.last_ms = now
+
+        name, labels = EVENTS[event] if event < len(EVENTS) else ('EVENT%d' % event, [])
+        values = []
+        rest = payload[3:]
+        if len(rest) % 2:   # an odd length means the first argument is a byte
+            values.append(rest[0])
+            rest = rest[1:]
+        for x in range(0, len(rest) - 1, 2):
+            values.append(int.from_bytes(rest[x:x + 2], 'little', signed=True))
+
+        fields = []
+        for x, value in enumerate(values):
+            label = labels[x] if x < len(labels) else 'arg%d' % x
+            if label.endswith('/10'):
+                fields.append('%s=%.1f' % (label[:-3], value / 10))
+            elif label in ('sensor', 'gate') and value >= 0:
+                fields.append('%s=%d' % (label, value + 1))   # numbered from 1 like the DEBUG output
+            else:
+                fields.append('%s=%d' % (label, value))
+        self.out.write('%10.3f %-12s %s\n' % (now / 1000, name, ' '.join(fields)))
+        self.out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('source')
+    parser.add_argument('--baud', type=int, default=250000)
+    args = parser.parse_args()
+
+    decoder = Decoder(sys.stdout)
+    if os.path.isfile(args.source):
+        with open(args.source, 'rb') as f:
+            decoder.feed(f.read())
+        return
+
+    import serial
+    with serial.Serial(args.source, args.baud, timeout=0.1) as port:
+        try:
+            while True:
+                decoder.feed(port.read(256))
+        except KeyboardInterrupt:
+            pass
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,81 @@
+/*
+  Replay.cpp - Feeds a captured sensor trace through the firmware's AcSensors
+  detection and reports when each tool was detected
+
+  Usage: replay TRACE [options]
+    --labels FILE     tool runs that really happened, "sensor on_ms off_ms" per line
+    --pass MS         time between ReadSensors() calls, the detect task runs every
+                      1000 / TASK_DETECT_HZ ms (default 50)
+    --slack MS        a detection this far ahead of a label still matches it (default 250)
+    --tuning ON:OFF:DEBOUNCE:WINDOW   try other sensitivities, debounce count and
+                      averaging window instead of the Configuration.h values
+  The first NUM_OFF_MAX_SAMPLES ms of the trace are used for calibration, so
+  every tool must be off when the capture starts.
+*/
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "Configuration.h"
+#include "GateConfig.h"
+#include "ReplayRun.h"
+#include "TraceFile.h"
+
+  static void printLatency(const char *what, int edges, long average, long worst)
+  {
+    if (edges) printf("  %s latency avg %ld ms, max %ld ms over %d edges\n", what, average, worst, edges);
+    else printf("  %s latency: no matched edges\n", what);
+  }
+
+  int main(int argc, char **argv)
+  {
+    const char *traceFile = NULL;
+    const char *labelFile = NULL;
+    unsigned long passMs = 50;
+    long slackMs = 250;
+    Tuning tuning = configuredTuning();
+
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      if (arg == "--labels" && i + 1 < argc) labelFile = argv[++i];
+      else if (arg == "--pass" && i + 1 < argc) passMs = strtoul(argv[++i], NULL, 10);
+      else if (arg == "--slack" && i + 1 < argc) slackMs = strtol(argv[++i], NULL, 10);
+      else if (arg == "--tuning" && i + 1 < argc) {
+        if (sscanf(argv[++i], "%f:%f:%d:%d", &tuning.sensitivityOn, &tuning.sensitivityOff, &tuning.debounce, &tuning.avgWindow) != 4) {
+          fprintf(stderr, "bad --tuning %s\n", argv[i]);
+          return 2;
+        }
+      }
+      else if (arg[0] != '-' && !traceFile) traceFile = argv[i];
+      else { fprintf(stderr, "unknown option %s\n", arg.c_str()); return 2; }
+    }
+    if (!traceFile || passMs == 0) { fprintf(stderr, "usage: replay TRACE [--labels FILE] [--pass MS] [--slack MS] [--tuning ON:OFF:DEBOUNCE:WINDOW]\n"); return 2; }
+
+    TraceFile trace;
+    std::string error;
+    if (!trace.load(traceFile, error)) { fprintf(stderr, "%s\n", error.c_str()); return 1; }
+    std::vector<ToolLabel> labels;
+    if (labelFile && !loadLabels(labelFile, labels, error)) { fprintf(stderr, "%s\n", error.c_str()); return 1; }
+
+    printf("Trace: %d sensors at %ld Hz each, %.1f s", trace.numSensors, trace.channelRate, trace.durationUs() / 1000000.0);
+    if (trace.droppedSamples) printf(", %lu samples dropped by the controller", trace.droppedSamples);
+    if (trace.badFrames) printf(", %lu bad frames (%lu samples filled in)", trace.badFrames, trace.missingSamples);
+    printf("\n");
+    for (int x = 0; x < NUM_AC_SENSORS; x++) {
+      bool traced = x < trace.numSensors && (trace.activeMask & (1U << x));
+      if ((GateConfig::sensorPin(x) != -1) != traced)
+        printf("Warning: sensor %d is %s in Configuration.h but %s in the trace\n", x + 1,
+               GateConfig::sensorPin(x) != -1 ? "enabled" : "disabled", traced ? "recorded" : "missing");
+    }
+    if (trace.mainsHz != MAINS_HZ) printf("Warning: trace was captured with MAINS_HZ %d\n", trace.mainsHz);
+    printf("Tuning: on %.2f, off %.2f, debounce %d, window %d\n", tuning.sensitivityOn, tuning.sensitivityOff, tuning.debounce, tuning.avgWindow);
+
+    ReplayScore score = replayTrace(trace, labels, tuning, passMs, slackMs, true);
+
+    if (labelFile) {
+      printLatency("On", score.onEdges, score.onLatencyAvg(), score.onLatencyMax);
+      printLatency("Off", score.offEdges, score.offLatencyAvg(), score.offLatencyMax);
+      printf("  False triggers %d, false releases %d, missed edges %d\n", score.falseOn, score.falseOff, score.missed);
+    }
+    return 0;
+  }
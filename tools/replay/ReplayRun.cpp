@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <algorithm>
+#include "Arduino.h"
+#include "Configuration.h"
+#include "AcSensors.h"
+#include "AdcSampler.h"
+#include "GateConfig.h"
+#include "SimShop.h"
+#include "ReplayRun.h"
+
+  static const TraceFile *currentTrace = NULL;
+
+  // Analog input stand-in: the trace sample for whichever sensor is on the pin
+  static int traceSource(int pin, unsigned long long time)
+  {
+    for (int x = 0; x < NUM_AC_SENSORS; x++)
+      if (GateConfig::sensorPin(x) == pin) return currentTrace->sampleAt(x, time);
+    return 0;
+  }
+
+  struct Detection { unsigned long ms; bool on; };
+
+  Tuning configuredTuning()
+  {
+    Tuning tuning = { AC_SENSOR_SENSITIVITY_ON, AC_SENSOR_SENSITIVITY_OFF, DEBOUNCE_STABLE_READINGS, AVG_READINGS };
+    return tuning;
+  }
+
+  void ReplayScore::add(const ReplayScore &other)
+  {
+    onEdges += other.onEdges;
+    onLatencyTotal += other.onLatencyTotal;
+    onLatencyMax = std::max(onLatencyMax, other.onLatencyMax);
+    offEdges += other.offEdges;
+    offLatencyTotal += other.offLatencyTotal;
+    offLatencyMax = std::max(offLatencyMax, other.offLatencyMax);
+    falseOn += other.falseOn;
+    falseOff += other.falseOff;
+    missed += other.missed;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Compare one sensor's detections with its labelled runs. A detection
+  // matches the latest label edge in the same direction at or before it
+  // (plus the slack), anything else is a false trigger or release.
+  //////////////////////////////////////////////////////////////////////
+  static void scoreSensor(int sensor, const std::vector<Detection> &detections, const std::vector<ToolLabel> &labels,
+                          long slack, bool report, ReplayScore &score)
+  {
+    struct Edge { unsigned long ms; bool on; bool matched; };
+    std::vector<Edge> edges;
+    for (size_t i = 0; i < labels.size(); i++) {
+      if (labels[i].sensor != sensor) continue;
+      edges.push_back({ labels[i].onMs, true, false });
+      edges.push_back({ labels[i].offMs, false, false });
+    }
+    std::sort(edges.begin(), edges.end(), [](const Edge &a, const Edge &b) { return a.ms < b.ms; });
+
+    for (size_t d = 0; d < detections.size(); d++) {
+      const Detection &det = detections[d];
+      Edge *latest = NULL;
+      for (size_t e = 0; e < edges.size() && edges[e].ms <= det.ms + slack; e++) latest = &edges[e];
+
+      bool labelledOn = latest && latest->on;
+      if (latest && labelledOn == det.on && !latest->matched) {
+        latest->matched = true;
+        long latency = (long)det.ms - (long)latest->ms;
+        if (det.on) {
+          score.onEdges++;
+          score.onLatencyTotal += latency;
+          score.onLatencyMax = std::max(score.onLatencyMax, latency);
+        } else {
+          score.offEdges++;
+          score.offLatencyTotal += latency;
+          score.offLatencyMax = std::max(score.offLatencyMax, latency);
+        }
+      } else if (det.on) {
+        score.falseOn++;
+        if (report) printf("    false trigger at %lu ms\n", det.ms);
+      } else {
+        score.falseOff++;
+        if (report) printf("    false release at %lu ms\n", det.ms);
+      }
+    }
+
+    for (size_t e = 0; e < edges.size(); e++) {
+      if (edges[e].matched) continue;
+      score.missed++;
+      if (report) printf("    missed tool %s at %lu ms\n", edges[e].on ? "on" : "off", edges[e].ms);
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // replayTrace(...)
+  //
+  // Run the unmodified detection against the trace on the simulated clock
+  //////////////////////////////////////////////////////////////////////
+  ReplayScore replayTrace(const TraceFile &trace, const std::vector<ToolLabel> &labels, const Tuning &tuning,
+                          unsigned long passMs, long slackMs, bool report)
+  {
+    currentTrace = &trace;
+    SimShop::reset();
+    for (int x = 0; x < NUM_AC_SENSORS; x++)
+      if (GateConfig::sensorPin(x) != -1) SimShop::sensors[GateConfig::sensorPin(x)].source = traceSource;
+
+    AcSensors acsensors;
+    acsensors.SetTuning(tuning.sensitivityOn, tuning.sensitivityOff, tuning.debounce, tuning.avgWindow);
+    acsensors.InitializeSensors();
+
+    if (report) {
+      if (AdcSampler::channelRate() != trace.channelRate)
+        printf("Warning: replay samples at %ld Hz per sensor, trace was %ld Hz\n", AdcSampler::channelRate(), trace.channelRate);
+      printf("Baselines:");
+      for (int x = 0; x < NUM_AC_SENSORS; x++) printf(" %.1f", acsensors.GetOffReading(x));
+      printf("\n");
+    }
+
+    std::vector<Detection> detections[NUM_AC_SENSORS];
+    bool state[NUM_AC_SENSORS] = {};
+    unsigned long long endUs = trace.durationUs();
+    while (SimShop::clock < endUs) {
+      delay(passMs);
+      acsensors.ReadSensors();
+      for (int x = 0; x < NUM_AC_SENSORS; x++) {
+        bool on = acsensors.Triggered(x);
+        if (on != state[x]) detections[x].push_back({ millis(), on });
+        state[x] = on;
+      }
+    }
+    AdcSampler::end();
+
+    ReplayScore score;
+    for (int x = 0; x < NUM_AC_SENSORS; x++) {
+      if (GateConfig::sensorPin(x) == -1) continue;
+      if (report) {
+        printf("Sensor %d:", x + 1);
+        if (detections[x].empty()) printf(" never triggered");
+        for (size_t d = 0; d < detections[x].size(); d++)
+          printf(" %s@%lu", detections[x][d].on ? "on" : "off", detections[x][d].ms);
+        printf("\n");
+      }
+      scoreSensor(x, detections[x], labels, slackMs, report && !labels.empty(), score);
+    }
+    return score;
+  }
@@ -0,0 +1,45 @@
+/*
+  ReplayRun.h - Runs a trace through AcSensors with a given tuning and scores
+  the detections against the trace's labels
+  Released into the public domain.
+*/
+#ifndef ReplayRun_h
+#define ReplayRun_h
+
+#include <vector>
+#include "TraceFile.h"
+
+  // The detection settings a replay can change without rebuilding
+  struct Tuning {
+    float sensitivityOn;     // AC_SENSOR_SENSITIVITY_ON
+    float sensitivityOff;    // AC_SENSOR_SENSITIVITY_OFF
+    int debounce;            // DEBOUNCE_STABLE_READINGS
+    int avgWindow;           // AVG_READINGS
+  };
+
+  Tuning configuredTuning();   // the values in Configuration.h
+
+  struct ReplayScore {
+    int onEdges = 0;         // labelled switch ons that were detected
+    long onLatencyTotal = 0;
+    long onLatencyMax = 0;
+    int offEdges = 0;
+    long offLatencyTotal = 0;
+    long offLatencyMax = 0;
+    int falseOn = 0;         // detected on while the labels say off
+    int falseOff = 0;        // detected off while the labels say on
+    int missed = 0;          // labelled edges never detected
+
+    void add(const ReplayScore &other);
+    bool clean() const { return falseOn == 0 && falseOff == 0 && missed == 0; }
+    long onLatencyAvg() const { return onEdges ? onLatencyTotal / onEdges : 0; }
+    long offLatencyAvg() const { return offEdges ? offLatencyTotal / offEdges : 0; }
+  };
+
+  // Calibrate on the start of the trace and replay the rest of it, one
+  // ReadSensors() and Triggered() pass every passMs. With report set every
+  // detection and scoring decision is printed.
+  ReplayScore replayTrace(const TraceFile &trace, const std::vector<ToolLabel> &labels, const Tuning &tuning,
+                          unsigned long passMs, long slackMs, bool report);
+
+#endif
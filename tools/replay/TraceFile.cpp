@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <string.h>
+#include "TraceFile.h"
+#include "TraceCapture.h"
+
+  //////////////////////////////////////////////////////////////////////
+  // load(const char *path, std::string &error)
+  //
+  // Parse every frame in a capture. A bad checksum drops the byte after
+  // the sync and searches for the next one, so a noisy serial link only
+  // loses the damaged frames.
+  //////////////////////////////////////////////////////////////////////
+  bool TraceFile::load(const char *path, std::string &error)
+  {
+    FILE *f = fopen(path, "rb");
+    if (!f) { error = std::string("can't open ") + path; return false; }
+    std::vector<uint8_t> data;
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), f)) > 0) data.insert(data.end(), buffer, buffer + n);
+    fclose(f);
+
+    bool haveHeader = false;
+    int lastOverruns = -1;
+    size_t pos = 0;
+    while (pos + 4 <= data.size())
+    {
+      if (data[pos] != TraceCapture::frame_sync) { pos++; continue; }
+      uint8_t type = data[pos + 1];
+      uint8_t length = data[pos + 2];
+      if (pos + 4 + length > data.size()) break;   // capture stopped mid frame
+
+      const uint8_t *payload = &data[pos + 3];
+      uint8_t sum = type + length;
+      for (int x = 0; x < length; x++) sum += payload[x];
+      if (sum != data[pos + 3 + length]) { badFrames++; pos++; continue; }
+      pos += 4 + length;
+
+      if (type == TraceCapture::frame_header && length >= 6)
+      {
+        // Version 1 traces, from before more than 8 sensors, have a 1 byte mask
+        int maskBytes = payload[0] == 1 ? 1 : 2;
+        if (payload[0] != 1 && payload[0] != TraceCapture::trace_version) { error = "unsupported trace version"; return false; }
+        if (length < 5 + maskBytes) { badFrames++; continue; }
+        numSensors = payload[1] < max_sensors ? payload[1] : max_sensors;
+        activeMask = maskBytes == 1 ? payload[2] : payload[2] | (payload[3] << 8);
+        channelRate = payload[2 + maskBytes] | (payload[3 + maskBytes] << 8);
+        mainsHz = payload[4 + maskBytes];
+        haveHeader = true;
+      }
+      else if (type == TraceCapture::frame_samples && length >= 6 && haveHeader)
+      {
+        int sensor = payload[0];
+        if (sensor >= numSensors) { badFrames++; continue; }
+        unsigned long seq = payload[1] | ((unsigned long)payload[2] << 8) | ((unsigned long)payload[3] << 16) | ((unsigned long)payload[4] << 24);
+
+        // The overrun count is cumulative, only its low byte is sent
+        if (lastOverruns >= 0) droppedSamples += (uint8_t)(payload[5] - lastOverruns);
+        lastOverruns = payload[5];
+
+        std::vector<uint16_t> &s = samples[sensor];
+        if (seq < s.size()) continue;   // already have these, the controller probably restarted
+        if (seq > s.size()) {
+          // Frames were lost, hold the last value so later samples keep their times
+          missingSamples += seq - s.size();
+          s.resize(seq, s.empty() ? 0 : s.back());
+        }
+        for (int x = 6; x + 1 < length; x += 2) s.push_back(payload[x] | (payload[x + 1] << 8));
+      }
+    }
+
+    if (!haveHeader) { error = "no trace header found"; return false; }
+    if (channelRate <= 0) { error = "trace has no sampled sensors"; return false; }
+    return true;
+  }
+
+  int TraceFile::sampleAt(int sensor, unsigned long long us) const
+  {
+    const std::vector<uint16_t> &s = samples[sensor];
+    if (s.empty()) return 0;
+    unsigned long long index = us * channelRate / 1000000ULL;
+    return index < s.size() ? s[index] : s.back();
+  }
+
+  unsigned long long TraceFile::durationUs() const
+  {
+    size_t shortest = 0;
+    bool any = false;
+    for (int x = 0; x < numSensors; x++) {
+      if (!(activeMask & (1U << x))) continue;
+      if (!any || samples[x].size() < shortest) shortest = samples[x].size();
+      any = true;
+    }
+    return any ? shortest * 1000000ULL / channelRate : 0;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // loadLabels(const char *path, std::vector<ToolLabel> &labels, std::string &error)
+  //
+  // One tool run per line, "sensor on_ms off_ms", # starts a comment
+  //////////////////////////////////////////////////////////////////////
+  bool loadLabels(const char *path, std::vector<ToolLabel> &labels, std::string &error)
+  {
+    FILE *f = fopen(path, "r");
+    if (!f) { error = std::string("can't open ") + path; return false; }
+
+    char line[256];
+    int lineNumber = 0;
+    while (fgets(line, sizeof(line), f))
+    {
+      lineNumber++;
+      char *hash = strchr(line, '#');
+      if (hash) *hash = 0;
+
+      ToolLabel label;
+      int fields = sscanf(line, "%d %lu %lu", &label.sensor, &label.onMs, &label.offMs);
+      if (fields <= 0) continue;   // blank or comment
+      if (fields != 3 || label.sensor < 1 || label.sensor > TraceFile::max_sensors || label.offMs < label.onMs) {
+        error = std::string(path) + ": bad label on line " + std::to_string(lineNumber);
+        fclose(f);
+        return false;
+      }
+      label.sensor--;
+      labels.push_back(label);
+    }
+    fclose(f);
+    return true;
+  }
@@ -0,0 +1,40 @@
+/*
+  TraceFile.h - Reads sensor traces written by the TRACE_CAPTURE firmware and
+  the label files that say when each tool was really running
+  Released into the public domain.
+*/
+#ifndef TraceFile_h
+#define TraceFile_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+  class TraceFile {
+    public:
+      static const int max_sensors = 16;
+
+      int numSensors = 0;
+      uint16_t activeMask = 0;                  // bit per sensor with a pin
+      long channelRate = 0;                     // samples per second for each sensor
+      int mainsHz = 0;
+      std::vector<uint16_t> samples[max_sensors];
+      unsigned long droppedSamples = 0;         // sampler overruns reported by the firmware
+      unsigned long badFrames = 0;              // frames with a bad checksum or length
+      unsigned long missingSamples = 0;         // samples lost with bad frames, filled with the previous value
+
+      bool load(const char *path, std::string &error);
+      int sampleAt(int sensor, unsigned long long us) const;   // sample covering a time since capture start
+      unsigned long long durationUs() const;                   // time covered by the shortest channel
+  };
+
+  // A tool run from a label file: "sensor on_ms off_ms", sensor is 1-based
+  struct ToolLabel {
+    int sensor;               // 0-based
+    unsigned long onMs;
+    unsigned long offMs;
+  };
+
+  bool loadLabels(const char *path, std::vector<ToolLabel> &labels, std::string &error);
+
+#endif
@@ -0,0 +1,303 @@
+/*
+  Sweep.cpp - Searches the detection settings for the fastest response with
+  no false triggers over a set of recorded sensor traces
+
+  Usage: sweep TRACE... [options]
+    --on MIN:MAX:STEP        AC_SENSOR_SENSITIVITY_ON values to try (default 1.2:3.0:0.2)
+    --off MIN:MAX:STEP       AC_SENSOR_SENSITIVITY_OFF values, only below on (default 1.1:2.5:0.2)
+    --debounce MIN:MAX       DEBOUNCE_STABLE_READINGS values (default 1:5)
+    --window MIN:MAX:STEP    AVG_READINGS values, no more than AVG_READINGS (default 5:AVG_READINGS:5)
+    --anneal STEPS           refine the best grid point with STEPS annealing moves per job
+    --jobs N                 worker processes (default: one per core)
+    --pass MS / --slack MS   as for replay
+    --off-weight W           off latency counts W times as much as on latency (default 0.1)
+    --out FILE               write the winning settings as a Configuration.h fragment
+  Every trace needs its labels in TRACE.labels. A configuration only
+  qualifies with no false triggers, false releases or missed edges on any trace.
+*/
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "Arduino.h"
+#include "Configuration.h"
+#include "ReplayRun.h"
+#include "TraceFile.h"
+
+  struct Corpus {
+    std::vector<TraceFile> traces;
+    std::vector<std::vector<ToolLabel> > labels;
+  };
+
+  struct Options {
+    unsigned long passMs = 50;
+    long slackMs = 250;
+    float offWeight = 0.1f;
+  };
+
+  // One evaluated configuration, sent back from the workers through a pipe
+  struct Result {
+    Tuning tuning;
+    ReplayScore score;
+    double cost;
+  };
+
+  static const double failure_cost = 1e9;   // added per false or missed edge
+
+  static Corpus corpus;
+  static Options options;
+
+  static Result evaluate(const Tuning &tuning)
+  {
+    Result result;
+    result.tuning = tuning;
+    for (size_t i = 0; i < corpus.traces.size(); i++)
+      result.score.add(replayTrace(corpus.traces[i], corpus.labels[i], tuning, options.passMs, options.slackMs, false));
+
+    const ReplayScore &s = result.score;
+    result.cost = s.onLatencyAvg() + options.offWeight * s.offLatencyAvg()
+                + failure_cost * (s.falseOn + s.falseOff + s.missed);
+    return result;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Simulated annealing from a starting point: small steps on one setting
+  // at a time, accepting worse results with a falling probability
+  //////////////////////////////////////////////////////////////////////
+  static Result anneal(const Tuning &start, int steps, unsigned seed)
+  {
+    srand(seed);
+    Result current = evaluate(start);
+    Result best = current;
+    double temperature = 200;   // ms of latency a step may lose early on
+    double cooling = pow(1.0 / temperature, 1.0 / (steps > 1 ? steps : 1));
+
+    for (int i = 0; i < steps; i++, temperature *= cooling) {
+      Tuning next = current.tuning;
+      switch (rand() % 4) {
+        case 0: next.sensitivityOn += (rand() % 2 ? 0.05f : -0.05f); break;
+        case 1: next.sensitivityOff += (rand() % 2 ? 0.05f : -0.05f); break;
+        case 2: next.debounce += (rand() % 2 ? 1 : -1); break;
+        default: next.avgWindow += (rand() % 2 ? 1 : -1); break;
+      }
+      if (next.sensitivityOff < 1.0f || next.sensitivityOff > next.sensitivityOn - 0.04f || next.debounce < 1
+          || next.avgWindow < 1 || next.avgWindow > AVG_READINGS) continue;
+
+      Result tried = evaluate(next);
+      double delta = tried.cost - current.cost;
+      if (delta <= 0 || (double)rand() / RAND_MAX < exp(-delta / temperature)) current = tried;
+      if (current.cost < best.cost) best = current;
+    }
+    return best;
+  }
+
+  //////////////////////////////////////////////////////////////////////
+  // Run work on every job in its own process, collecting the results
+  // each job writes to its pipe. The replays share the simulated shop's
+  // global state, so processes rather than threads keep them apart.
+  // Progress is shown when the number of results is known.
+  //////////////////////////////////////////////////////////////////////
+  template <typename Work> static std::vector<Result> runJobs(int jobs, size_t expected, Work work)
+  {
+    std::vector<int> pipes;
+    std::vector<pid_t> workers;
+    for (int job = 0; job < jobs; job++) {
+      int fds[2];
+      if (pipe(fds) != 0) { perror("pipe"); exit(1); }
+      fflush(stdout);
+      pid_t pid = fork();
+      if (pid < 0) { perror("fork"); exit(1); }
+      if (pid == 0) {
+        close(fds[0]);
+        work(job, fds[1]);
+        close(fds[1]);
+        _exit(0);
+      }
+      close(fds[1]);
+      pipes.push_back(fds[0]);
+      workers.push_back(pid);
+    }
+
+    std::vector<Result> results;
+    std::vector<std::string> partial(jobs);
+    int open = jobs;
+    size_t shownPercent = 0;
+    while (open > 0) {
+      std::vector<pollfd> fds;
+      std::vector<int> index;
+      for (int job = 0; job < jobs; job++)
+        if (pipes[job] >= 0) { fds.push_back({ pipes[job], POLLIN, 0 }); index.push_back(job); }
+      if (poll(fds.data(), fds.size(), -1) < 0) { perror("poll"); exit(1); }
+
+      for (size_t i = 0; i < fds.size(); i++) {
+        if (!fds[i].revents) continue;
+        int job = index[i];
+        char buffer[4096];
+        ssize_t n = read(pipes[job], buffer, sizeof(buffer));
+        if (n <= 0) { close(pipes[job]); pipes[job] = -1; open--; continue; }
+
+        // Results arrive as whole structs split across reads
+        partial[job].append(buffer, n);
+        while (partial[job].size() >= sizeof(Result)) {
+          Result result;
+          memcpy(&result, partial[job].data(), sizeof(Result));
+          partial[job].erase(0, sizeof(Result));
+          results.push_back(result);
+        }
+      }
+
+      size_t percent = expected ? results.size() * 100 / expected : 0;
+      if (expected && percent != shownPercent) fprintf(stderr, "\r%zu%%", percent);
+      shownPercent = percent;
+    }
+    if (expected > 0) fprintf(stderr, "\n");
+    for (size_t i = 0; i < workers.size(); i++) waitpid(workers[i], NULL, 0);
+    return results;
+  }
+
+  static void sendResult(int fd, const Result &result)
+  {
+    const char *data = (const char *)&result;
+    size_t left = sizeof(result);
+    while (left > 0) {
+      ssize_t n = write(fd, data, left);
+      if (n <= 0) _exit(1);
+      data += n;
+      left -= n;
+    }
+  }
+
+  static bool parseRange(const char *text, float &min, float &max, float &step)
+  {
+    return sscanf(text, "%f:%f:%f", &min, &max, &step) == 3 && step > 0 && max >= min;
+  }
+
+  static bool better(const Result &a, const Result &b)
+  {
+    if (a.cost != b.cost) return a.cost < b.cost;
+    return a.score.onLatencyMax < b.score.onLatencyMax;
+  }
+
+  static void printResult(const Result &r)
+  {
+    const ReplayScore &s = r.score;
+    printf("  on %.2f off %.2f debounce %d window %2d | on avg %4ld max %4ld ms | off avg %4ld max %4ld ms",
+           r.tuning.sensitivityOn, r.tuning.sensitivityOff, r.tuning.debounce, r.tuning.avgWindow,
+           s.onLatencyAvg(), s.onLatencyMax, s.offLatencyAvg(), s.offLatencyMax);
+    if (!s.clean()) printf(" | %d false on, %d false off, %d missed", s.falseOn, s.falseOff, s.missed);
+    printf("\n");
+  }
+
+  static void writeFragment(FILE *f, const Result &r, size_t traces)
+  {
+    char date[16];
+    time_t now = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%d", localtime(&now));
+    fprintf(f, "// Tuned by tools/sweep %s over %zu traces: on latency avg %ld ms (max %ld), off latency avg %ld ms (max %ld)\n",
+            date, traces, r.score.onLatencyAvg(), r.score.onLatencyMax, r.score.offLatencyAvg(), r.score.offLatencyMax);
+    fprintf(f, "#define AVG_READINGS %d\n", r.tuning.avgWindow);
+    fprintf(f, "#define AC_SENSOR_SENSITIVITY_ON  %.2f\n", r.tuning.sensitivityOn);
+    fprintf(f, "#define AC_SENSOR_SENSITIVITY_OFF %.2f\n", r.tuning.sensitivityOff);
+    fprintf(f, "#define DEBOUNCE_STABLE_READINGS  %d\n", r.tuning.debounce);
+  }
+
+  int main(int argc, char **argv)
+  {
+    float onMin = 1.2f, onMax = 3.0f, onStep = 0.2f;
+    float offMin = 1.1f, offMax = 2.5f, offStep = 0.2f;
+    int debounceMin = 1, debounceMax = 5;
+    float windowMin = 5, windowMax = AVG_READINGS, windowStep = 5;
+    int annealSteps = 0;
+    int jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char *outFile = NULL;
+    std::vector<std::string> traceFiles;
+
+    for (int i = 1; i < argc; i++) {
+      std::string arg = argv[i];
+      bool ok = true;
+      if (arg == "--on" && i + 1 < argc) ok = parseRange(argv[++i], onMin, onMax, onStep);
+      else if (arg == "--off" && i + 1 < argc) ok = parseRange(argv[++i], offMin, offMax, offStep);
+      else if (arg == "--window" && i + 1 < argc) ok = parseRange(argv[++i], windowMin, windowMax, windowStep);
+      else if (arg == "--debounce" && i + 1 < argc) ok = sscanf(argv[++i], "%d:%d", &debounceMin, &debounceMax) == 2 && debounceMin >= 1;
+      else if (arg == "--anneal" && i + 1 < argc) annealSteps = atoi(argv[++i]);
+      else if (arg == "--jobs" && i + 1 < argc) jobs = atoi(argv[++i]);
+      else if (arg == "--pass" && i + 1 < argc) options.passMs = strtoul(argv[++i], NULL, 10);
+      else if (arg == "--slack" && i + 1 < argc) options.slackMs = strtol(argv[++i], NULL, 10);
+      else if (arg == "--off-weight" && i + 1 < argc) options.offWeight = atof(argv[++i]);
+      else if (arg == "--out" && i + 1 < argc) outFile = argv[++i];
+      else if (arg[0] != '-') traceFiles.push_back(arg);
+      else ok = false;
+      if (!ok) { fprintf(stderr, "bad option %s\n", arg.c_str()); return 2; }
+    }
+    if (traceFiles.empty()) { fprintf(stderr, "usage: sweep TRACE... [options], see Sweep.cpp\n"); return 2; }
+    if (jobs < 1) jobs = 1;
+    if (windowMax > AVG_READINGS) windowMax = AVG_READINGS;
+    #if DETECTION_MODE != DETECT_MEAN
+    windowMin = windowMax = AVG_READINGS;   // the cycle based modes don't use the average
+    #endif
+
+    // Load everything before forking so the workers share it
+    for (size_t i = 0; i < traceFiles.size(); i++) {
+      TraceFile trace;
+      std::vector<ToolLabel> labels;
+      std::string error;
+      std::string labelFile = traceFiles[i] + ".labels";
+      if (!trace.load(traceFiles[i].c_str(), error) || !loadLabels(labelFile.c_str(), labels, error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+      }
+      corpus.traces.push_back(trace);
+      corpus.labels.push_back(labels);
+    }
+
+    // Grid of every combination, with a small tolerance so the float steps reach MAX
+    std::vector<Tuning> grid;
+    for (float on = onMin; on <= onMax + 1e-4f; on += onStep)
+      for (float off = offMin; off <= offMax + 1e-4f && off < on - 1e-4f; off += offStep)
+        for (int debounce = debounceMin; debounce <= debounceMax; debounce++)
+          for (float window = windowMin; window <= windowMax + 1e-4f; window += windowStep)
+            grid.push_back({ on, off, debounce, (int)(window + 0.5f) });
+    if (grid.empty()) { fprintf(stderr, "the ranges leave nothing to try\n"); return 2; }
+
+    printf("Sweeping %zu configurations over %zu traces with %d jobs\n", grid.size(), corpus.traces.size(), jobs);
+    std::vector<Result> results = runJobs(jobs, grid.size(), [&](int job, int fd) {
+      for (size_t i = job; i < grid.size(); i += jobs) sendResult(fd, evaluate(grid[i]));
+    });
+    std::sort(results.begin(), results.end(), better);
+
+    if (annealSteps > 0) {
+      Tuning start = results[0].tuning;
+      printf("Annealing from the best grid point, %d steps in each of %d jobs\n", annealSteps, jobs);
+      std::vector<Result> refined = runJobs(jobs, 0, [&](int job, int fd) {
+        sendResult(fd, anneal(start, annealSteps, 1000 + job));
+      });
+      results.insert(results.end(), refined.begin(), refined.end());
+      std::sort(results.begin(), results.end(), better);
+    }
+
+    printf("Best configurations:\n");
+    for (size_t i = 0; i < results.size() && i < 10; i++) printResult(results[i]);
+
+    const Result &winner = results[0];
+    if (!winner.score.clean()) {
+      printf("No configuration was free of false or missed edges, widen the ranges or check the labels\n");
+      return 1;
+    }
+
+    writeFragment(stdout, winner, corpus.traces.size());
+    if (outFile) {
+      FILE *f = fopen(outFile, "w");
+      if (!f) { fprintf(stderr, "can't write %s\n", outFile); return 1; }
+      writeFragment(f, winner, corpus.traces.size());
+      fclose(f);
+      printf("Written to %s\n", outFile);
+    }
+    return 0;
+  }